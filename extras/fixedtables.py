@@ -0,0 +1,70 @@
+import math
+
+# Generates the lookup tables in src/FixedPoint.cpp and reports the worst
+# error of the interpolated fixedSin() and fixedAtan2() results against
+# floating point, in units of the result, and the error of approxDistance().
+
+SINE_STEPS = 256  # table entries per quarter turn
+ATAN_STEPS = 256  # table entries for ratios from 0 to 1
+
+
+def sine_table():
+    return [int(round(math.sin(i * math.pi / 2 / SINE_STEPS) * 0x10000)) for i in range(SINE_STEPS)]
+
+
+def atan_table():
+    return [int(round(math.atan(i / ATAN_STEPS) / (2 * math.pi) * 0x10000)) for i in range(ATAN_STEPS + 1)]
+
+
+def fixed_sin(table, pos):
+    # pos is 0 to 0x4000, a quarter turn
+    i, frac = pos >> 6, pos & 0x3F
+    a = table[i] if i < SINE_STEPS else 0x10000
+    if frac == 0:
+        return a
+    b = table[i + 1] if i + 1 < SINE_STEPS else 0x10000
+    return a + (((b - a) * frac) >> 6)
+
+
+def fixed_atan(table, ratio):
+    # ratio is 0 to 0x10000, 0 to 1
+    i, frac = ratio >> 8, ratio & 0xFF
+    if frac == 0:
+        return table[i]
+    return table[i] + (((table[i + 1] - table[i]) * frac) >> 8)
+
+
+def approx_distance(dx, dy):
+    # The same shifts as approxDistance(): hi*123/128 + lo*51/128
+    hi, lo = max(abs(dx), abs(dy)), min(abs(dx), abs(dy))
+    return hi - (hi >> 5) - (hi >> 7) + (lo >> 2) + (lo >> 3) + (lo >> 6) + (lo >> 7)
+
+
+def write_table(ctype, name, values):
+    print('static const %s %s[%d] = {' % (ctype, name, len(values)))
+    for i in range(0, len(values), 8):
+        print('  ' + ', '.join('0x%04X' % v for v in values[i:i + 8]) + ',')
+    print('};\n')
+
+
+sines = sine_table()
+atans = atan_table()
+write_table('uint16_t', 'sineTable', sines)
+write_table('uint16_t', 'atanTable', atans)
+
+sin_error = max(abs(fixed_sin(sines, pos) - math.sin(pos * math.pi / 0x8000) * 0x10000) for pos in range(0x4001))
+atan_error = max(abs(fixed_atan(atans, r) - math.atan(r / 0x10000) / (2 * math.pi) * 0x10000) for r in range(0x10001))
+print('// fixedSin() worst error: %.3f / 65536' % sin_error)
+print('// fixedAtan2() worst error: %.3f / 65536 of a turn' % atan_error)
+
+# The coefficients alone, over all directions, then the rounding of the shifts
+ratios = [(123 + 51 * t / 4096) / 128 / math.hypot(1, t / 4096) for t in range(4097)]
+short, long = 1 - min(ratios), max(ratios) - 1
+rounding = 0
+for dx in range(0, 1024, 3):
+    for dy in range(0, dx + 1):
+        exact = math.hypot(dx, dy)
+        approx = approx_distance(dx, dy)
+        rounding = max(rounding, approx - exact * (1 + long), exact * (1 - short) - approx)
+print('// approxDistance() error: %.2f%% short to %.2f%% long, plus %.2f units of rounding' %
+      (short * 100, long * 100, rounding))
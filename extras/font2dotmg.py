@@ -0,0 +1,199 @@
+import argparse
+import os
+
+# Converts a BDF bitmap font, or a TrueType/OpenType font rendered at a given
+# size, into a proportional Font for DotMG::setFont() (see Font in DotMG.h).
+
+
+class Glyph:
+    def __init__(self, code, rows, width, height, offset_x, offset_y, advance):
+        self.code = code
+        self.rows = rows  # lists of 0/1 pixels, top row first
+        self.width = width
+        self.height = height
+        self.offset_x = offset_x  # relative to the pen position
+        self.offset_y = offset_y  # relative to the baseline
+        self.advance = advance
+
+
+def load_bdf(path, first, last):
+    glyphs = {}
+    ascent = descent = 0
+    with open(path, 'rt') as fh:
+        lines = iter(fh.read().splitlines())
+
+    for line in lines:
+        words = line.split()
+        if not words:
+            continue
+        if words[0] == 'FONT_ASCENT':
+            ascent = int(words[1])
+        elif words[0] == 'FONT_DESCENT':
+            descent = int(words[1])
+        elif words[0] == 'STARTCHAR':
+            code = advance = None
+            bbx = (0, 0, 0, 0)
+            for line in lines:
+                words = line.split()
+                if words[0] == 'ENCODING':
+                    code = int(words[1])
+                elif words[0] == 'DWIDTH':
+                    advance = int(words[1])
+                elif words[0] == 'BBX':
+                    bbx = tuple(int(w) for w in words[1:5])
+                elif words[0] == 'BITMAP':
+                    break
+            w, h, x_off, y_off = bbx
+            rows = []
+            for line in lines:
+                if line.startswith('ENDCHAR'):
+                    break
+                bits = int(line, 16)
+                row_bits = len(line) * 4
+                rows.append([(bits >> (row_bits - 1 - x)) & 1 for x in range(w)])
+            if code is not None and first <= code <= last:
+                glyphs[code] = Glyph(code, rows, w, h, x_off, -(y_off + h), advance)
+
+    return glyphs, ascent, descent, []
+
+
+def load_truetype(path, size, first, last, threshold, kern):
+    # Works as of Pillow 8.0.0
+    # Run: pip install Pillow to use PIL
+    from PIL import Image, ImageDraw, ImageFont
+
+    font = ImageFont.truetype(path, size)
+    ascent, descent = font.getmetrics()
+    glyphs = {}
+
+    for code in range(first, last + 1):
+        ch = chr(code)
+        advance = int(round(font.getlength(ch)))
+        x0, y0, x1, y1 = font.getbbox(ch)
+        w, h = max(x1 - x0, 0), max(y1 - y0, 0)
+        rows = []
+        if w and h:
+            img = Image.new('L', (w, h), 0)
+            ImageDraw.Draw(img).text((-x0, -y0), ch, font=font, fill=255)
+            px = list(img.getdata())
+            rows = [[1 if px[y*w + x] >= threshold else 0 for x in range(w)] for y in range(h)]
+        glyphs[code] = Glyph(code, rows, w, h, x0, y0 - ascent, advance)
+
+    pairs = []
+    if kern:
+        for a in range(first, last + 1):
+            for b in range(first, last + 1):
+                pair = chr(a) + chr(b)
+                amount = int(round(font.getlength(pair) - font.getlength(chr(a)) - font.getlength(chr(b))))
+                if amount != 0:
+                    pairs.append((a, b, max(-128, min(127, amount))))
+
+    return glyphs, ascent, descent, pairs
+
+
+def trim(glyph):
+    # Drop blank rows and columns around the glyph, keeping its position
+    rows = glyph.rows
+    while rows and not any(rows[0]):
+        rows = rows[1:]
+        glyph.offset_y += 1
+    while rows and not any(rows[-1]):
+        rows = rows[:-1]
+    if not rows:
+        glyph.rows, glyph.width, glyph.height = [], 0, 0
+        return
+    left = min(row.index(1) for row in rows if any(row))
+    right = max(len(row) - row[::-1].index(1) for row in rows if any(row))
+    glyph.rows = [row[left:right] for row in rows]
+    glyph.offset_x += left
+    glyph.width = right - left
+    glyph.height = len(rows)
+
+
+def pack_rows(glyph):
+    data = []
+    for row in glyph.rows:
+        for start in range(0, glyph.width, 8):
+            byte = 0
+            for bit, on in enumerate(row[start:start + 8]):
+                byte |= on << bit
+            data.append(byte)
+    return data
+
+
+def write_font(out, name, glyphs, ascent, descent, pairs, first, last, line_height):
+    bitmap = []
+    table = []
+    for code in range(first, last + 1):
+        glyph = glyphs.get(code)
+        if glyph is None:
+            table.append((0, 0, 0, 0, 0, 0, code))
+            continue
+        trim(glyph)
+        data = pack_rows(glyph)
+        table.append((len(bitmap), glyph.width, glyph.height, glyph.offset_x, glyph.offset_y, glyph.advance, code))
+        bitmap.extend(data)
+
+    if len(bitmap) > 0xFFFF:
+        print('font is too large')
+        exit(1)
+
+    with open(out, 'wt') as fh:
+        fh.write('#ifndef ' + name.upper() + '_H\n')
+        fh.write('#define ' + name.upper() + '_H\n\n')
+        fh.write('const uint8_t ' + name + 'Bitmap[] = {\n')
+        for i in range(0, len(bitmap), 16):
+            fh.write('  ' + ', '.join('0x%02X' % b for b in bitmap[i:i + 16]) + ',\n')
+        fh.write('};\n\n')
+        fh.write('const FontGlyph ' + name + 'Glyphs[] = {\n')
+        for offset, w, h, x, y, advance, code in table:
+            label = repr(chr(code)) if 32 <= code < 127 else str(code)
+            fh.write('  {%d, %d, %d, %d, %d, %d}, // %s\n' % (offset, w, h, x, y, advance, label))
+        fh.write('};\n\n')
+        kerning = 'NULL'
+        if pairs:
+            kerning = name + 'Kerning'
+            fh.write('const FontKerning ' + kerning + '[] = {\n')
+            for a, b, amount in sorted(pairs):
+                fh.write('  {%d, %d, %d},\n' % (a, b, amount))
+            fh.write('};\n\n')
+        fh.write('const Font ' + name + ' = {' + name + 'Bitmap, ' + name + 'Glyphs, ' +
+                 '%d, %d, %d, %d, %s, %d};\n' % (first, last, line_height or ascent + descent, ascent, kerning, len(pairs)))
+        fh.write('\n#endif // ' + name.upper() + '_H\n')
+
+
+parser = argparse.ArgumentParser(description='Convert fonts for use with the dotMG library.')
+parser.add_argument('input', help="path of the font: a '.bdf' bitmap font, or a TrueType/OpenType font")
+parser.add_argument('output', help="path of the output file, ending in '.h'")
+parser.add_argument('--size', type=int, default=8,
+                    help='with TrueType/OpenType fonts, the size in pixels to render at (default: 8)')
+parser.add_argument('--threshold', type=int, default=128,
+                    help='with TrueType/OpenType fonts, the coverage (0-255) at which a pixel is set (default: 128)')
+parser.add_argument('--first', type=int, default=32, help='the first character to include (default: 32)')
+parser.add_argument('--last', type=int, default=126, help='the last character to include (default: 126)')
+parser.add_argument('--line-height', type=int, default=0,
+                    help="the distance between lines (default: the font's ascent plus descent)")
+parser.add_argument('--no-kerning', dest='kerning', action='store_false',
+                    help='leave out kerning pairs')
+args = parser.parse_args()
+
+name, ext = os.path.splitext(os.path.basename(args.output))
+
+if ext != '.h':
+    print("output path extension must be '.h'")
+    exit(1)
+
+if not 0 <= args.first <= args.last <= 255:
+    print('characters must be in the range 0 to 255')
+    exit(1)
+
+if args.input.lower().endswith('.bdf'):
+    font = load_bdf(args.input, args.first, args.last)
+else:
+    font = load_truetype(args.input, args.size, args.first, args.last, args.threshold, args.kerning)
+
+glyphs, ascent, descent, pairs = font
+if not args.kerning:
+    pairs = []
+
+write_font(args.output, name, glyphs, ascent, descent, pairs, args.first, args.last, args.line_height)
@@ -1,10 +1,25 @@
+import argparse
 import os
+import struct
 import sys
 
 # Works as of Pillow 7.2.0
 # Run: pip install Pillow to use PIL
 from PIL import Image
 
+# Run-length encoded sprite runs (see DotMGBase::drawSprite() in DotMG.h)
+RUN_SKIP = 0x0000
+RUN_OPAQUE = 0x4000
+RUN_TRANSLUCENT = 0x8000
+RUN_MAX_LENGTH = 0x3FFF
+
+# Per-tile flags (see Tileset in DotMG.h)
+TILE_OPAQUE = 0x01
+TILE_EMPTY = 0x02
+TILE_SOLID = 0x04
+TILE_SLOPE_UP = 0x08
+TILE_SLOPE_DOWN = 0x10
+
 
 def to_4_bits(n):
     return int((n * 0xF) / 0xFF)
@@ -18,22 +33,252 @@ def to_4444_rgba(p):
         a = to_4_bits(p[3])
     return (r << 12) | (g << 8) | (b << 4) | a
 
+def run_type(color):
+    alpha = color & 0xF
+    if alpha == 0:
+        return RUN_SKIP
+    if alpha == 0xF:
+        return RUN_OPAQUE
+    return RUN_TRANSLUCENT
+
+def encode_rle(data, width, height):
+    rows = []
+    for y in range(height):
+        row = data[y*width:(y+1)*width]
+
+        # Transparent pixels at the end of a row don't need a run
+        end = width
+        while end > 0 and run_type(row[end-1]) == RUN_SKIP:
+            end -= 1
+
+        runs = []
+        x = 0
+        while x < end:
+            kind = run_type(row[x])
+            n = 1
+            while x + n < end and n < RUN_MAX_LENGTH and run_type(row[x+n]) == kind:
+                n += 1
+            runs.append(kind | n)
+            if kind != RUN_SKIP:
+                runs.extend(row[x:x+n])
+            x += n
+        rows.append(runs)
+
+    # Row offsets are counted in words from the start of the sprite
+    offsets = []
+    pos = 2 + height + 1
+    for runs in rows:
+        offsets.append(pos)
+        pos += len(runs)
+    offsets.append(pos)
+
+    if pos > 0xFFFF:
+        print('image is too large to run-length encode')
+        exit(1)
+
+    return [width, height] + offsets + [w for runs in rows for w in runs]
+
+def trim_bounds(data, width, height):
+    xs = [i % width for i, c in enumerate(data) if c & 0xF]
+    ys = [i // width for i, c in enumerate(data) if c & 0xF]
+    if not xs:
+        return (0, 0, 0, 0)
+    return (min(xs), min(ys), max(xs) + 1, max(ys) + 1)
+
+def parse_size(text):
+    w, h = text.lower().split('x')
+    return (int(w), int(h))
+
+def parse_tiles(text):
+    # A list of tile indexes and ranges, such as '1-5,9'
+    tiles = set()
+    for part in text.split(','):
+        if '-' in part:
+            first, last = part.split('-')
+            tiles.update(range(int(first), int(last) + 1))
+        else:
+            tiles.add(int(part))
+    return tiles
+
+def parse_pivot(text, width, height):
+    if text == 'topleft':
+        return (0, 0)
+    if text == 'center':
+        return (width // 2, height // 2)
+    if text == 'bottom':
+        return (width // 2, height)
+    x, y = text.split(',')
+    return (int(x), int(y))
+
+def load_frames(paths, grid):
+    frames = []
+    for path in paths:
+        img = Image.open(path)
+        label = os.path.basename(path)
+        if grid is None:
+            frames.append((label, img))
+            continue
+        cell_w, cell_h = grid
+        for y in range(0, img.height - cell_h + 1, cell_h):
+            for x in range(0, img.width - cell_w + 1, cell_w):
+                frames.append(('%s (%d, %d)' % (label, x, y), img.crop((x, y, x + cell_w, y + cell_h))))
+    return frames
+
+def pack_shelves(sizes, max_width):
+    # Place the tallest frames first, filling rows ("shelves") left to right
+    order = sorted(range(len(sizes)), key=lambda i: (-sizes[i][1], -sizes[i][0]))
+    positions = [(0, 0)] * len(sizes)
+    x = y = shelf_height = width = 0
+    for i in order:
+        w, h = sizes[i]
+        if w == 0 or h == 0:
+            continue
+        if x > 0 and x + w > max_width:
+            y += shelf_height
+            x = shelf_height = 0
+        positions[i] = (x, y)
+        x += w
+        shelf_height = max(shelf_height, h)
+        width = max(width, x)
+    return positions, width, y + shelf_height
+
+def build_atlas(frames, trim, pivot, max_width):
+    entries = []
+    for label, img in frames:
+        data = list(map(to_4444_rgba, img.getdata()))
+        if trim:
+            x0, y0, x1, y1 = trim_bounds(data, img.width, img.height)
+        else:
+            x0, y0, x1, y1 = (0, 0, img.width, img.height)
+        pixels = [data[y*img.width + x] for y in range(y0, y1) for x in range(x0, x1)]
+        px, py = parse_pivot(pivot, img.width, img.height)
+        entries.append({
+            'label': label, 'pixels': pixels,
+            'width': x1 - x0, 'height': y1 - y0, 'offset': (x0, y0),
+            'frame': (img.width, img.height), 'pivot': (px, py),
+        })
+
+    positions, width, height = pack_shelves([(e['width'], e['height']) for e in entries], max_width)
+    width = max(width, 1)
+    height = max(height, 1)
+
+    image = [0] * (width * height)
+    for e, (x, y) in zip(entries, positions):
+        e['pos'] = (x, y)
+        for row in range(e['height']):
+            start = (y + row) * width + x
+            image[start:start + e['width']] = e['pixels'][row*e['width']:(row+1)*e['width']]
+
+    return image, width, height, entries
+
+def write_atlas(out, name, frames, trim, pivot, max_width):
+    image, width, height, entries = build_atlas(frames, trim, pivot, max_width)
+    with open(out, 'wt') as fh:
+        fh.write('#ifndef '+ name.upper() + '_H\n')
+        fh.write('#define '+ name.upper() + '_H\n\n')
+        fh.write('const uint16_t ' + name + 'ImageData[] = {\n' + format_data_string(image, width) + '\n};\n\n')
+        fh.write('const AtlasFrame ' + name + 'Frames[] = {\n')
+        for i, e in enumerate(entries):
+            fh.write('  {%d, %d, %d, %d, %d, %d, %d, %d, %d, %d}, // %d: %s\n' % (
+                e['pos'][0], e['pos'][1], e['width'], e['height'],
+                e['offset'][0], e['offset'][1], e['frame'][0], e['frame'][1],
+                e['pivot'][0], e['pivot'][1], i, e['label']))
+        fh.write('};\n\n')
+        fh.write('const SpriteAtlas ' + name + ' = {(const Color *)' + name + 'ImageData, ' +
+                 str(width) + ', ' + str(height) + ', ' + str(len(entries)) + ', ' + name + 'Frames};\n')
+        fh.write('\n#endif // '+ name.upper() + '_H\n')
+
+def tile_flags(pixels):
+    alphas = [c & 0xF for c in pixels]
+    if all(a == 0xF for a in alphas):
+        return TILE_OPAQUE
+    if all(a == 0 for a in alphas):
+        return TILE_EMPTY
+    return 0
+
+def write_tileset(out, name, frames, extra_flags):
+    tiles = [list(map(to_4444_rgba, img.getdata())) for label, img in frames]
+    flags = [tile_flags(t) for t in tiles]
+    for flag, indexes in extra_flags:
+        for i in indexes:
+            if i < len(flags):
+                flags[i] |= flag
+    tile_w, tile_h = frames[0][1].width, frames[0][1].height
+    with open(out, 'wt') as fh:
+        fh.write('#ifndef '+ name.upper() + '_H\n')
+        fh.write('#define '+ name.upper() + '_H\n\n')
+        fh.write('const uint16_t ' + name + 'ImageData[] = {\n')
+        fh.write(',\n'.join('  // %d: %s\n' % (i, frames[i][0]) + format_data_string(t, tile_w)
+                             for i, t in enumerate(tiles)))
+        fh.write('\n};\n\n')
+        fh.write('const uint8_t ' + name + 'Flags[] = {\n')
+        fh.write(format_data_string(flags, 16, '0x%02X'))
+        fh.write('\n};\n\n')
+        fh.write('const Tileset ' + name + ' = {(const Color *)' + name + 'ImageData, ' +
+                 str(tile_w) + ', ' + str(tile_h) + ', ' + str(len(tiles)) + ', ' + name + 'Flags, NULL, 0};\n')
+        fh.write('\n#endif // '+ name.upper() + '_H\n')
+
+def mask_words(data, width, height, min_alpha):
+    # One bit per pixel, 32 to a word with the leftmost pixel in bit 0
+    stride = (width + 31) // 32
+    words = []
+    for y in range(height):
+        row = [0] * stride
+        for x in range(width):
+            if (data[y*width + x] & 0xF) >= min_alpha:
+                row[x // 32] |= 1 << (x % 32)
+        words.extend(row)
+    return words, stride
+
+def write_mask(out, name, data, width, height, min_alpha):
+    words, stride = mask_words(data, width, height, min_alpha)
+    with open(out, 'wt') as fh:
+        fh.write('#ifndef '+ name.upper() + '_H\n')
+        fh.write('#define '+ name.upper() + '_H\n\n')
+        fh.write('const uint32_t ' + name + 'Bits[] = {\n' + format_data_string(words, stride, '0x%08X') + '\n};\n\n')
+        fh.write('const CollisionMask ' + name + ' = {' + name + 'Bits, ' + str(width) + ', ' + str(height) + '};\n')
+        fh.write('\n#endif // '+ name.upper() + '_H\n')
+
 def chunk(lst, n):
     for i in range(0, len(lst), n):
         yield lst[i:i+n]
 
-def format_data_string(data, width):
-    data_str = list(map(lambda d: '0x%04X' % d, data))
+def format_data_string(data, width, fmt='0x%04X'):
+    data_str = list(map(lambda d: fmt % d, data))
     rows = chunk(data_str, width)
     rows_str = list(map(lambda r: '  ' + ', '.join(r), rows))
     return ',\n'.join(rows_str)
 
-if len(sys.argv) < 3:
-    print('input and output paths required')
-    exit(1)
+parser = argparse.ArgumentParser(description='Convert images for use with the dotMG library.')
+parser.add_argument('input', nargs='+', help='path of the image to convert (several are allowed with --atlas)')
+parser.add_argument('output', help="path of the output file, ending in '.mg' or '.h'")
+parser.add_argument('--rle', action='store_true',
+                    help='output a run-length encoded sprite for drawSprite()')
+parser.add_argument('--atlas', action='store_true',
+                    help='pack all input frames into a SpriteAtlas for drawFrame()')
+parser.add_argument('--tileset', type=parse_size, metavar='WxH',
+                    help='split the input images into tiles of this size and output a Tileset for drawTileMap()')
+parser.add_argument('--mask', action='store_true',
+                    help='output a 1-bit CollisionMask of the solid pixels for collideMasks()')
+parser.add_argument('--mask-alpha', type=int, default=1,
+                    help='with --mask, the lowest 4-bit alpha (1-15) of a solid pixel (default: 1)')
+parser.add_argument('--solid', type=parse_tiles, default=set(), metavar='TILES',
+                    help="with --tileset, the tiles that block movement, such as '1-5,9'")
+parser.add_argument('--slope-up', type=parse_tiles, default=set(), metavar='TILES',
+                    help='with --tileset, the tiles whose floor rises from left to right')
+parser.add_argument('--slope-down', type=parse_tiles, default=set(), metavar='TILES',
+                    help='with --tileset, the tiles whose floor falls from left to right')
+parser.add_argument('--grid', type=parse_size, metavar='WxH',
+                    help='with --atlas, split each input image into frames of this size')
+parser.add_argument('--pivot', default='topleft',
+                    help="with --atlas, the frame pivot: 'topleft', 'center', 'bottom' or 'X,Y' (default: topleft)")
+parser.add_argument('--no-trim', dest='trim', action='store_false',
+                    help='with --atlas, keep the transparent borders of frames')
+parser.add_argument('--max-width', type=int, default=256,
+                    help='with --atlas, the maximum width of the atlas image (default: 256)')
+args = parser.parse_args()
 
-path = sys.argv[1]
-out = sys.argv[2]
+out = args.output
 
 name, ext = os.path.splitext(os.path.basename(out))
 
@@ -41,11 +286,50 @@ if ext != '.mg' and ext != '.h':
     print("output path extension must be '.mg' or '.h'")
     exit(1)
 
+if args.atlas:
+    if args.rle or ext != '.h':
+        print("atlas output must be a '.h' file and can't be run-length encoded")
+        exit(1)
+    write_atlas(out, name, load_frames(args.input, args.grid), args.trim, args.pivot, args.max_width)
+    exit(0)
+
+if args.tileset:
+    if args.rle or ext != '.h':
+        print("tileset output must be a '.h' file and can't be run-length encoded")
+        exit(1)
+    extra_flags = [(TILE_SOLID, args.solid), (TILE_SLOPE_UP, args.slope_up), (TILE_SLOPE_DOWN, args.slope_down)]
+    write_tileset(out, name, load_frames(args.input, args.tileset), extra_flags)
+    exit(0)
+
+if len(args.input) != 1:
+    print('only one input path is allowed without --atlas')
+    exit(1)
+
+path = args.input[0]
+
 img = Image.open(path)
 data = list(img.getdata())
 data = list(map(to_4444_rgba, data))
 
-if ext == '.mg':
+if args.mask:
+    if args.rle or ext != '.h':
+        print("mask output must be a '.h' file and can't be run-length encoded")
+        exit(1)
+    write_mask(out, name, data, img.width, img.height, args.mask_alpha)
+elif args.rle:
+    sprite = encode_rle(data, img.width, img.height)
+    if ext == '.mg':
+        with open(out, 'wb') as fh:
+            fh.write(struct.pack('<%dH' % len(sprite), *sprite))
+    else: # .h
+        with open(out, 'wt') as fh:
+            fh.write('#ifndef '+ name.upper() + '_H\n')
+            fh.write('#define '+ name.upper() + '_H\n\n')
+            fh.write('const uint16_t ' + name + 'Width = ' + str(img.width) + ';\n')
+            fh.write('const uint16_t ' + name + 'Height = ' + str(img.height) + ';\n')
+            fh.write('const uint16_t ' + name + '[] = {\n' + format_data_string(sprite, 16) + '\n};\n')
+            fh.write('\n#endif // '+ name.upper() + '_H\n')
+elif ext == '.mg':
     with open(out, 'wb') as fh:
         fh.write(bytearray([img.width, img.height] + data))
 else: # .cpp
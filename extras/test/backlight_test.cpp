@@ -0,0 +1,95 @@
+// Host test for the backlight fade in src/Backlight.cpp.
+//
+// A mock pin driver records every level written, and the clock is a plain
+// variable, so the ramp can be checked step by step without hardware.
+//
+// Build and run from the repository root:
+//   g++ -Isrc extras/test/backlight_test.cpp src/Backlight.cpp -o backlight_test && ./backlight_test
+
+#include <stdio.h>
+#include "Backlight.h"
+
+static int pinLevel = -1;
+static int pinWrites = 0;
+static int failures = 0;
+
+static void mockWrite(uint8_t level)
+{
+  pinLevel = level;
+  pinWrites++;
+}
+
+#define CHECK(cond) \
+  do { if (!(cond)) { printf("%s:%d: %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+int main()
+{
+  Backlight backlight(mockWrite);
+  unsigned long now = 5000;
+
+  // Nothing is written until the output is enabled
+  CHECK(pinWrites == 0);
+  backlight.enable(true);
+  CHECK(pinLevel == BACKLIGHT_MAX);
+
+  // A fade from 255 to 0 over 255 ms steps down once per millisecond
+  backlight.fade(0, 255, now);
+  CHECK(backlight.fading());
+  int lastLevel = pinLevel;
+
+  for (int ms = 1; ms < 255; ms++)
+  {
+    backlight.update(now + ms);
+    CHECK(pinLevel == 255 - ms);
+    CHECK(pinLevel <= lastLevel);
+    lastLevel = pinLevel;
+  }
+
+  backlight.update(now + 255);
+  CHECK(pinLevel == 0);
+  CHECK(backlight.level() == 0);
+  CHECK(!backlight.fading());
+
+  // Levels are only written when they change
+  pinWrites = 0;
+  backlight.fade(10, 1000, now);
+  backlight.update(now + 10);
+  backlight.update(now + 20);
+  CHECK(pinWrites == 0);
+  backlight.update(now + 150);
+  CHECK(pinWrites == 1 && pinLevel == 1);
+
+  // set() stops a fade
+  backlight.set(100);
+  CHECK(pinLevel == 100);
+  CHECK(!backlight.fading());
+  backlight.update(now + 2000);
+  CHECK(pinLevel == 100);
+
+  // A fade keeps running while the output is off, and the current level is
+  // restored when it's turned back on
+  backlight.fade(200, 100, now);
+  backlight.enable(false);
+  CHECK(pinLevel == 0);
+  pinWrites = 0;
+  backlight.update(now + 50);
+  CHECK(pinWrites == 0);
+  CHECK(backlight.level() == 150);
+  backlight.enable(true);
+  CHECK(pinLevel == 150);
+
+  // The clock wrapping around doesn't break a fade
+  now = 0xFFFFFFFFUL - 10;
+  backlight.fade(0, 100, now);
+  backlight.update(now + 60);
+  CHECK(pinLevel == 150 - 150*60/100);
+
+  // A zero duration sets the level at once
+  backlight.fade(42, 0, now);
+  CHECK(pinLevel == 42);
+  CHECK(!backlight.fading());
+
+  if (failures == 0)
+    printf("backlight_test: ok\n");
+  return failures != 0;
+}
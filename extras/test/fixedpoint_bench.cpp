@@ -0,0 +1,264 @@
+// Host accuracy and speed benchmark for src/FixedPoint.cpp.
+//
+// Each fixed point function is run over the same inputs as its floating point
+// counterpart. The worst error of both is measured against double precision,
+// in the units of the fixed point result, and the time per call is reported.
+// The run fails if a fixed point function is less accurate than its
+// documentation says.
+//
+// Host timings only compare the two approaches. On the dotMG, which has no
+// floating point hardware, the float functions are far slower still.
+//
+// Build and run from the repository root:
+//   g++ -O2 -Iextras/test/stub -Isrc extras/test/fixedpoint_bench.cpp src/FixedPoint.cpp -o fixedpoint_bench && ./fixedpoint_bench
+
+#include <stdio.h>
+#include <time.h>
+#include "FixedPoint.h"
+
+#define SAMPLES 0x10000
+#define REPEATS 200
+
+static Angle angles[SAMPLES];
+static float radians[SAMPLES];
+static int32_t pointX[SAMPLES];
+static int32_t pointY[SAMPLES];
+static float floatX[SAMPLES];
+static float floatY[SAMPLES];
+static Fixed squares[SAMPLES];
+static float floatSquares[SAMPLES];
+
+static volatile uint32_t fixedSink;
+static volatile float floatSink;
+static int failures = 0;
+
+static double turnError(double angle, double exact)
+{
+  // The difference between two angles in 1/65536 of a turn, across the wrap
+  double error = fmod(angle - exact, 65536.0);
+
+  if (error > 32768)
+    error -= 65536;
+  else if (error < -32768)
+    error += 65536;
+  return fabs(error);
+}
+
+static void report(const char *fixedName, double fixedError, clock_t fixedTime,
+                   const char *floatName, double floatError, clock_t floatTime)
+{
+  double calls = (double)SAMPLES * REPEATS;
+
+  printf("%-16s %9.3f %8.2f ns   %-7s %9.3f %8.2f ns\n",
+         fixedName, fixedError, fixedTime * 1e9 / CLOCKS_PER_SEC / calls,
+         floatName, floatError, floatTime * 1e9 / CLOCKS_PER_SEC / calls);
+}
+
+static void check(bool ok, const char *name)
+{
+  if (!ok)
+  {
+    printf("%s is outside its documented accuracy\n", name);
+    failures++;
+  }
+}
+
+static void makeInputs()
+{
+  srand(1);
+
+  for (int i = 0; i < SAMPLES; i++)
+  {
+    angles[i] = i;
+    radians[i] = i * (float)(2 * M_PI / 65536);
+
+    // Points at all scales, including tiny ones where the ratio is coarse
+    int shift = rand() % 16;
+    pointX[i] = (rand() % 200001 - 100000) >> shift;
+    pointY[i] = (rand() % 200001 - 100000) >> shift;
+    floatX[i] = pointX[i];
+    floatY[i] = pointY[i];
+
+    squares[i] = Fixed::fromRaw((int32_t)((((uint32_t)rand() << 16) ^ rand()) & 0x7FFFFFFF));
+    floatSquares[i] = squares[i].toFloat();
+  }
+}
+
+static void sineAndCosine()
+{
+  double fixedSinError = 0, fixedCosError = 0, sinfError = 0, cosfError = 0;
+
+  for (int i = 0; i < SAMPLES; i++)
+  {
+    double exactSin = sin(i * 2 * M_PI / 65536) * 65536;
+    double exactCos = cos(i * 2 * M_PI / 65536) * 65536;
+
+    fixedSinError = fmax(fixedSinError, fabs(fixedSin(angles[i]).raw - exactSin));
+    fixedCosError = fmax(fixedCosError, fabs(fixedCos(angles[i]).raw - exactCos));
+    sinfError = fmax(sinfError, fabs(sinf(radians[i]) * 65536.0 - exactSin));
+    cosfError = fmax(cosfError, fabs(cosf(radians[i]) * 65536.0 - exactCos));
+  }
+
+  check(fixedSinError <= 2 && fixedCosError <= 2, "fixedSin()/fixedCos()");
+
+  clock_t t0 = clock();
+  uint32_t sum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      sum += fixedSin(angles[i]).raw;
+  fixedSink = sum;
+
+  clock_t t1 = clock();
+  float fsum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      fsum += sinf(radians[i]);
+  floatSink = fsum;
+
+  clock_t t2 = clock();
+  sum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      sum += fixedCos(angles[i]).raw;
+  fixedSink = sum;
+
+  clock_t t3 = clock();
+  fsum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      fsum += cosf(radians[i]);
+  floatSink = fsum;
+
+  clock_t t4 = clock();
+  report("fixedSin()", fixedSinError, t1 - t0, "sinf()", sinfError, t2 - t1);
+  report("fixedCos()", fixedCosError, t3 - t2, "cosf()", cosfError, t4 - t3);
+}
+
+static void arctangent()
+{
+  double fixedError = 0, floatError = 0;
+
+  for (int i = 0; i < SAMPLES; i++)
+  {
+    if (pointX[i] == 0 && pointY[i] == 0)
+      continue;
+
+    double exact = atan2((double)pointY[i], (double)pointX[i]) / (2 * M_PI) * 65536;
+    fixedError = fmax(fixedError, turnError(fixedAtan2(pointY[i], pointX[i]), exact));
+    floatError = fmax(floatError, turnError(atan2f(floatY[i], floatX[i]) / (float)(2 * M_PI) * 65536.0, exact));
+  }
+
+  check(fixedError <= 2, "fixedAtan2()");
+
+  clock_t t0 = clock();
+  uint32_t sum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      sum += fixedAtan2(pointY[i], pointX[i]);
+  fixedSink = sum;
+
+  clock_t t1 = clock();
+  float fsum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      fsum += atan2f(floatY[i], floatX[i]);
+  floatSink = fsum;
+
+  clock_t t2 = clock();
+  report("fixedAtan2()", fixedError, t1 - t0, "atan2f()", floatError, t2 - t1);
+}
+
+static void squareRoot()
+{
+  double fixedError = 0, floatError = 0;
+  bool roundedDown = true;
+
+  for (int i = 0; i < SAMPLES; i++)
+  {
+    double exact = sqrt(squares[i].raw / 65536.0) * 65536;
+    int32_t result = fixedSqrt(squares[i]).raw;
+
+    roundedDown = roundedDown && result <= exact && result + 1 > exact;
+    fixedError = fmax(fixedError, fabs(result - exact));
+    floatError = fmax(floatError, fabs(sqrtf(floatSquares[i]) * 65536.0 - exact));
+  }
+
+  check(roundedDown, "fixedSqrt()");
+
+  clock_t t0 = clock();
+  uint32_t sum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      sum += fixedSqrt(squares[i]).raw;
+  fixedSink = sum;
+
+  clock_t t1 = clock();
+  float fsum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      fsum += sqrtf(floatSquares[i]);
+  floatSink = fsum;
+
+  clock_t t2 = clock();
+  report("fixedSqrt()", fixedError, t1 - t0, "sqrtf()", floatError, t2 - t1);
+}
+
+static void distance()
+{
+  // Errors here are in percent of the distance, since that's how the
+  // estimate is documented
+  double fixedError = 0, floatError = 0;
+  bool withinBounds = true;
+
+  for (int i = 0; i < SAMPLES; i++)
+  {
+    double exact = hypot((double)pointX[i], (double)pointY[i]);
+    double result = approxDistance(pointX[i], pointY[i]);
+
+    withinBounds = withinBounds && result >= exact * 0.96 - 4 && result <= exact * 1.041 + 4;
+
+    // Leave out short distances, where the rounding of the shifts outweighs
+    // the percentage
+    if (exact >= 10000)
+    {
+      fixedError = fmax(fixedError, fabs(result - exact) / exact * 100);
+      floatError = fmax(floatError, fabs(hypotf(floatX[i], floatY[i]) - exact) / exact * 100);
+    }
+  }
+
+  check(withinBounds, "approxDistance()");
+
+  clock_t t0 = clock();
+  uint32_t sum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      sum += approxDistance(pointX[i], pointY[i]);
+  fixedSink = sum;
+
+  clock_t t1 = clock();
+  float fsum = 0;
+  for (int r = 0; r < REPEATS; r++)
+    for (int i = 0; i < SAMPLES; i++)
+      fsum += hypotf(floatX[i], floatY[i]);
+  floatSink = fsum;
+
+  clock_t t2 = clock();
+  report("approxDistance()", fixedError, t1 - t0, "hypotf()", floatError, t2 - t1);
+}
+
+int main()
+{
+  makeInputs();
+
+  printf("%-16s %9s %11s   %-7s %9s %11s\n", "function", "error", "time", "float", "error", "time");
+  sineAndCosine();
+  arctangent();
+  squareRoot();
+  distance();
+  printf("Errors are in 1/65536 of the result (of a turn for angles), and in\n"
+         "percent for approxDistance() at distances of 10000 or more.\n");
+
+  if (failures == 0)
+    printf("fixedpoint_bench: ok\n");
+  return failures != 0;
+}
@@ -0,0 +1,20 @@
+// Host stand-ins for the hardware parts of DotMGCore and the Arduino core,
+// so that drawing can be tested into the frame buffer.
+
+#include "DotMGCore.h"
+
+static unsigned long now;
+static uint8_t buf1[DISP_WIDTH*DISP_HEIGHT*12/8];
+static uint8_t buf2[DISP_WIDTH*DISP_HEIGHT*12/8];
+
+unsigned long millis() { return now; }
+unsigned long micros() { return now * 1000; }
+void delay(unsigned long ms) { now += ms; }
+void randomSeed(unsigned long seed) { srand(seed); }
+
+uint8_t *DotMGCore::stage = buf1;
+
+DotMGCore::DotMGCore() { }
+void DotMGCore::boot() { }
+void DotMGCore::blit() { stage = (stage == buf1) ? buf2 : buf1; }
+uint8_t DotMGCore::buttonsState() { return 0; }
@@ -0,0 +1 @@
+// Empty: the tests don't use EEPROM.
@@ -0,0 +1,37 @@
+// The parts of the Arduino Print class used by DotMG.
+
+#ifndef PRINT_H
+#define PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+class Print
+{
+  public:
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *buffer, size_t size)
+    {
+      size_t n = 0;
+      while (size--)
+        n += write(*buffer++);
+      return n;
+    }
+
+    size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+    size_t print(const char *str) { return write(str); }
+
+    size_t print(long value)
+    {
+      char buf[24];
+      snprintf(buf, sizeof buf, "%ld", value);
+      return write(buf);
+    }
+
+    virtual ~Print() {}
+};
+
+#endif
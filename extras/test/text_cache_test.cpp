@@ -0,0 +1,142 @@
+// Host test for DotMG::drawCachedText() and DotMG::queueText().
+//
+// Cached and queued text must leave the same pixels as drawString(),
+// including after partial updates, with a font whose glyphs stick out of
+// their cells.
+//
+// Build and run from the repository root:
+//   g++ -Iextras/test/stub -Isrc -o text_cache_test extras/test/text_cache_test.cpp
+//     extras/test/stub/DotMGCore.cpp src/DotMG.cpp src/Blending.cpp src/FixedPoint.cpp src/Backlight.cpp
+//   ./text_cache_test
+
+#include <stdio.h>
+#include "DotMG.h"
+
+// Digits drawn as blocks of varying size that reach past their advance on
+// either side and above the line
+static const uint8_t blockBitmap[] = {0x1F, 0x1B, 0x15, 0x1B, 0x1F, 0x11, 0x1F};
+
+static const FontGlyph blockGlyphs[] = {
+  {0, 5, 7, -1, -7, 4}, // '0'
+  {0, 3, 6, -2, -6, 2}, // '1'
+  {0, 5, 5,  0, -5, 3}, // '2'
+  {0, 4, 7, -1, -8, 4}, // '3'
+  {0, 5, 6,  1, -6, 4}, // '4'
+  {0, 2, 7, -1, -7, 2}, // '5'
+  {0, 5, 4,  0, -3, 3}, // '6'
+  {0, 4, 7, -2, -7, 3}, // '7'
+  {0, 5, 7,  0, -7, 4}, // '8'
+  {0, 3, 6,  0, -6, 2}, // '9'
+};
+
+static const FontKerning blockKerning[] = {
+  {'1', '1', -1},
+  {'3', '7', -2},
+  {'7', '1', 1},
+};
+
+static const Font blockFont = {blockBitmap, blockGlyphs, '0', '9', 8, 6, blockKerning, 3};
+
+static DotMG dmg;
+static Color expected[WIDTH*HEIGHT];
+static Color cachePixels[64*16];
+static Color freshPixels[64*16];
+static int failures = 0;
+
+static void fillPattern()
+{
+  Color *fb = dmg.frameBuffer();
+
+  for (int i = 0; i < WIDTH*HEIGHT; i++)
+    fb[i] = Color(0x1234 + i*7);
+}
+
+// Draw with drawString(), drawCachedText() and queueText(), and compare the
+// screens
+static void checkText(TextCache &cache, const char *text, int16_t x, int16_t y)
+{
+  fillPattern();
+  dmg.drawString(x, y, text);
+  memcpy(expected, dmg.frameBuffer(), sizeof expected);
+
+  fillPattern();
+  dmg.drawCachedText(x, y, cache, text);
+
+  if (memcmp(expected, dmg.frameBuffer(), sizeof expected) != 0)
+  {
+    printf("'%s' at %d, %d differs from drawString()\n", text, x, y);
+    failures++;
+  }
+
+  fillPattern();
+  dmg.queueText(0, x, y, text);
+  dmg.flushDrawList();
+
+  if (memcmp(expected, dmg.frameBuffer(), sizeof expected) != 0)
+  {
+    printf("queued '%s' at %d, %d differs from drawString()\n", text, x, y);
+    failures++;
+  }
+
+  // After a partial update, the cache holds what a full render would
+  if (strcmp(cache.text, text) == 0)
+  {
+    TextCache fresh(freshPixels, 64, 16);
+    dmg.drawCachedText(x, y, fresh, text);
+
+    for (int row = 0; row < cache.height; row++)
+    {
+      if (memcmp(cachePixels + row*64, freshPixels + row*64, cache.width * sizeof(Color)) != 0)
+      {
+        printf("'%s': partial update differs from a full render\n", text);
+        failures++;
+        break;
+      }
+    }
+  }
+}
+
+static void checkCounter(Color color, BlendFunc blend, Color bg, BlendFunc bgBlend)
+{
+  TextCache cache(cachePixels, 64, 16);
+  char text[12];
+
+  dmg.setTextColor(color, blend);
+  dmg.setTextBackground(bg, bgBlend);
+
+  for (long value = 0; value < 5000; value += 37)
+  {
+    snprintf(text, sizeof text, "%ld", value);
+    checkText(cache, text, 40, 30);
+  }
+
+  // Changes in the middle, and texts getting shorter
+  const char *texts[] = {"1371", "1771", "11", "3711", "37", "9", "", "1111111"};
+
+  for (size_t i = 0; i < sizeof texts / sizeof texts[0]; i++)
+    checkText(cache, texts[i], 2, 5);
+}
+
+int main()
+{
+  dmg.setFont(&blockFont);
+
+  for (uint8_t size = 1; size <= 2; size++)
+  {
+    dmg.setTextSize(size);
+
+    // Cached: no background, or opaque text over an opaque background
+    checkCounter(COLOR_WHITE, BLEND_ALPHA, COLOR_CLEAR, BLEND_ALPHA);
+    checkCounter(COLOR_YELLOW, BLEND_ALPHA, COLOR_BLUE, BLEND_ALPHA);
+    checkCounter(COLOR_YELLOW, BLEND_NONE, COLOR_BLUE, BLEND_NONE);
+
+    // Not cacheable, and drawn with drawString() instead
+    checkCounter(COLOR_WHITE, BLEND_ALPHA, Color(0x00F8), BLEND_ALPHA);
+    checkCounter(Color(0xFFF8), BLEND_ALPHA, COLOR_BLUE, BLEND_ALPHA);
+    checkCounter(COLOR_WHITE, BLEND_ALPHA, COLOR_BLUE, BLEND_ALPHA_GRAY);
+  }
+
+  if (failures == 0)
+    printf("text_cache_test: ok\n");
+  return failures != 0;
+}
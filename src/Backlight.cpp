@@ -0,0 +1,73 @@
+/**
+ * @file Backlight.cpp
+ * \brief
+ * The Backlight class for backlight brightness and timed fades.
+ */
+
+#include "Backlight.h"
+
+Backlight::Backlight(WriteFunc write)
+  : write(write), on(false), current(BACKLIGHT_MAX), from(0), to(0), duration(0), start(0)
+{
+}
+
+void Backlight::enable(bool on)
+{
+  this->on = on;
+  write(on ? current : 0);
+}
+
+void Backlight::set(uint8_t level)
+{
+  duration = 0;
+  current = level;
+
+  if (on)
+    write(level);
+}
+
+void Backlight::fade(uint8_t level, uint16_t duration, unsigned long now)
+{
+  if (duration == 0)
+  {
+    set(level);
+    return;
+  }
+
+  from = current;
+  to = level;
+  start = now;
+  this->duration = duration;
+}
+
+void Backlight::update(unsigned long now)
+{
+  if (duration == 0)
+    return;
+
+  unsigned long elapsed = now - start;
+  uint8_t level = to;
+
+  if (elapsed < duration)
+    level = from + ((int32_t)(to - from) * (int32_t)elapsed) / duration;
+  else
+    duration = 0;
+
+  if (level != current)
+  {
+    current = level;
+
+    if (on)
+      write(level);
+  }
+}
+
+uint8_t Backlight::level() const
+{
+  return current;
+}
+
+bool Backlight::fading() const
+{
+  return duration != 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file Backlight.h
+ * \brief
+ * The Backlight class for backlight brightness and timed fades.
+ *
+ * \details
+ * This is the hardware independent part of `DotMGCore::setBacklight()` and
+ * `DotMGCore::fadeBacklight()`. It doesn't read a clock or touch a pin
+ * itself: the time is passed in and levels are sent to a write function, so
+ * it can be run and observed on a host build.
+ */
+
+#ifndef BACKLIGHT_H
+#define BACKLIGHT_H
+
+#include <stdint.h>
+
+// The brightest backlight level
+#define BACKLIGHT_MAX 255
+
+/** \brief
+ * A backlight brightness with an optional timed fade.
+ *
+ * \details
+ * Members that change the level are expected to be called from both a sketch
+ * and a timer interrupt, so the state is `volatile`. The caller keeps the two
+ * from running at the same time, e.g. by stopping the timer first.
+ */
+class Backlight
+{
+  public:
+    /** \brief
+     * A function that sets the brightness of the backlight pin.
+     *
+     * \param level From 0 (off) to `BACKLIGHT_MAX`.
+     */
+    typedef void (*WriteFunc)(uint8_t level);
+
+    /** \brief
+     * Create a backlight at full brightness.
+     *
+     * \param write The function that sets the pin. It isn't called until
+     * `enable()`.
+     */
+    Backlight(WriteFunc write);
+
+    /** \brief
+     * Turn the backlight output on or off.
+     *
+     * \param on `true` writes the current level. `false` writes 0.
+     *
+     * \details
+     * While off, the level and any fade keep changing but nothing is
+     * written, so turning it back on restores the current level.
+     */
+    void enable(bool on);
+
+    /** \brief
+     * Set the level, stopping any fade.
+     *
+     * \param level From 0 (off) to `BACKLIGHT_MAX`.
+     */
+    void set(uint8_t level);
+
+    /** \brief
+     * Start a fade from the current level.
+     *
+     * \param level The level to end at.
+     * \param duration The length of the fade in milliseconds. 0 sets the
+     * level at once.
+     * \param now The current time in milliseconds.
+     */
+    void fade(uint8_t level, uint16_t duration, unsigned long now);
+
+    /** \brief
+     * Advance a fade.
+     *
+     * \param now The current time in milliseconds.
+     *
+     * \details
+     * The level is written only when it changes, so this can be called often.
+     */
+    void update(unsigned long now);
+
+    /** \brief
+     * Get the current level.
+     */
+    uint8_t level() const;
+
+    /** \brief
+     * Get whether a fade is in progress.
+     */
+    bool fading() const;
+
+  private:
+    WriteFunc write;
+    volatile bool on;
+    volatile uint8_t current;
+    volatile uint8_t from;
+    volatile uint8_t to;
+    volatile uint16_t duration;  // 0 when not fading
+    volatile unsigned long start;
+};
+
+#endif
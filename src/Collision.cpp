@@ -0,0 +1,653 @@
+/**
+ * @file Collision.cpp
+ * \brief
+ * Collision detection for many objects at a time.
+ */
+
+#include "Collision.h"
+
+// The same test as DotMGBase::collide(Rect, Rect)
+static inline bool overlaps(const Rect &a, const Rect &b)
+{
+  return !(b.x            >= a.x + a.width  ||
+           b.x + b.width  <= a.x            ||
+           b.y            >= a.y + a.height ||
+           b.y + b.height <= a.y);
+}
+
+//=================================================
+//========== Structure of arrays queries ==========
+//=================================================
+
+// 1 if the rectangle from x0, y0 to x1, y1 (exclusive) intersects the other,
+// computed without branches
+static inline uint32_t rectHit(int x0, int y0, int x1, int y1, int x, int y, int width, int height)
+{
+  return (x < x1) & (x + width > x0) & (y < y1) & (y + height > y0);
+}
+
+uint16_t collideRects(const Rect &rect, const RectArrays &rects, uint32_t *hits)
+{
+  const int x0 = rect.x, y0 = rect.y;
+  const int x1 = x0 + rect.width, y1 = y0 + rect.height;
+  const int16_t *x = rects.x, *y = rects.y;
+  const uint16_t *width = rects.width, *height = rects.height;
+  uint16_t count = 0;
+
+  for (uint16_t i = 0; i < rects.count; i += 32)
+  {
+    uint8_t n = min(rects.count - i, 32);
+    uint32_t word = 0;
+    uint8_t bit = 0;
+
+    // Four at a time, then the rest
+    for (; bit + 4 <= n; bit += 4, x += 4, y += 4, width += 4, height += 4)
+    {
+      word |= (rectHit(x0, y0, x1, y1, x[0], y[0], width[0], height[0]) << bit) |
+              (rectHit(x0, y0, x1, y1, x[1], y[1], width[1], height[1]) << (bit + 1)) |
+              (rectHit(x0, y0, x1, y1, x[2], y[2], width[2], height[2]) << (bit + 2)) |
+              (rectHit(x0, y0, x1, y1, x[3], y[3], width[3], height[3]) << (bit + 3));
+    }
+
+    for (; bit < n; bit++, x++, y++, width++, height++)
+      word |= rectHit(x0, y0, x1, y1, *x, *y, *width, *height) << bit;
+
+    *hits++ = word;
+    count += __builtin_popcount(word);
+  }
+
+  return count;
+}
+
+uint16_t collideRects(const Point &point, const RectArrays &rects, uint32_t *hits)
+{
+  // A point is within a rectangle exactly when a 1x1 rectangle there
+  // intersects it
+  return collideRects(Rect(point.x, point.y, 1, 1), rects, hits);
+}
+
+uint16_t findCollisions(const Rect &rect, const RectArrays &rects, uint16_t *indexes, uint16_t maxIndexes)
+{
+  const int x0 = rect.x, y0 = rect.y;
+  const int x1 = x0 + rect.width, y1 = y0 + rect.height;
+  const int16_t *x = rects.x, *y = rects.y;
+  const uint16_t *width = rects.width, *height = rects.height;
+  uint16_t count = 0;
+
+  // Every index is stored, but only kept by advancing past it on a hit
+  for (uint16_t i = 0; i < rects.count && count < maxIndexes; i++)
+  {
+    indexes[count] = i;
+    count += rectHit(x0, y0, x1, y1, x[i], y[i], width[i], height[i]);
+  }
+
+  return count;
+}
+
+uint16_t findCollisions(const Point &point, const RectArrays &rects, uint16_t *indexes, uint16_t maxIndexes)
+{
+  return findCollisions(Rect(point.x, point.y, 1, 1), rects, indexes, maxIndexes);
+}
+
+//=====================================
+//========== Collision masks ==========
+//=====================================
+
+static inline uint16_t maskStride(const CollisionMask &mask)
+{
+  return (mask.width + 31) >> 5;
+}
+
+// The 32 bits of a mask row starting at a column, which may be past the end
+// of a word
+static inline uint32_t maskBits(const uint32_t *row, uint16_t stride, uint16_t column)
+{
+  uint16_t word = column >> 5;
+  uint8_t shift = column & 0x1F;
+  uint32_t bits = row[word] >> shift;
+
+  if (shift != 0 && word + 1 < stride)
+    bits |= row[word + 1] << (32 - shift);
+
+  return bits;
+}
+
+CollisionMask makeCollisionMask(const Color *bitmap, uint16_t width, uint16_t height, uint32_t *bits, uint8_t minAlpha)
+{
+  CollisionMask mask = {bits, width, height};
+  uint16_t stride = maskStride(mask);
+
+  for (uint16_t y = 0; y < height; y++, bits += stride)
+  {
+    memset(bits, 0, stride * sizeof(uint32_t));
+
+    for (uint16_t x = 0; x < width; x++, bitmap++)
+    {
+      if (bitmap->a() >= minAlpha)
+        bits[x >> 5] |= 1UL << (x & 0x1F);
+    }
+  }
+
+  return mask;
+}
+
+bool collideMasks(const CollisionMask &maskA, Point posA, const CollisionMask &maskB, Point posB)
+{
+  // The intersection of the bounding rectangles
+  int x0 = max(posA.x, posB.x);
+  int y0 = max(posA.y, posB.y);
+  int x1 = min(posA.x + maskA.width, posB.x + maskB.width);
+  int y1 = min(posA.y + maskA.height, posB.y + maskB.height);
+
+  if (x0 >= x1 || y0 >= y1)
+    return false;
+
+  uint16_t strideA = maskStride(maskA);
+  uint16_t strideB = maskStride(maskB);
+  const uint32_t *rowA = maskA.bits + (y0 - posA.y) * strideA;
+  const uint32_t *rowB = maskB.bits + (y0 - posB.y) * strideB;
+
+  for (int y = y0; y < y1; y++, rowA += strideA, rowB += strideB)
+  {
+    for (int x = x0; x < x1; x += 32)
+    {
+      uint32_t bits = maskBits(rowA, strideA, x - posA.x) & maskBits(rowB, strideB, x - posB.x);
+
+      // Drop the bits past the intersection
+      if (x1 - x < 32)
+        bits &= (1UL << (x1 - x)) - 1;
+
+      if (bits)
+        return true;
+    }
+  }
+
+  return false;
+}
+
+//======================================
+//========== Swept rectangles ==========
+//======================================
+
+// When the moving span a0 to a1 starts and stops overlapping the span b0 to
+// b1, in 16.16 fixed point. Returns false if they never overlap.
+static bool sweepAxis(int a0, int a1, int b0, int b1, int32_t d, int64_t &entry, int64_t &exit)
+{
+  if (d == 0)
+  {
+    if (a0 >= b1 || a1 <= b0)
+      return false;
+
+    entry = INT64_MIN;
+    exit = INT64_MAX;
+    return true;
+  }
+
+  int64_t nearDistance = (d > 0) ? b0 - a1 : b1 - a0;
+  int64_t farDistance = (d > 0) ? b1 - a0 : b0 - a1;
+  entry = nearDistance * 0x100000000LL / d;
+  exit = farDistance * 0x100000000LL / d;
+  return true;
+}
+
+bool sweepRect(const Rect &rect, int32_t dx, int32_t dy, const Rect &obstacle, SweepHit &hit)
+{
+  int64_t xEntry, xExit, yEntry, yExit;
+
+  if (!sweepAxis(rect.x, rect.x + rect.width, obstacle.x, obstacle.x + obstacle.width, dx, xEntry, xExit) ||
+      !sweepAxis(rect.y, rect.y + rect.height, obstacle.y, obstacle.y + obstacle.height, dy, yEntry, yExit))
+    return false;
+
+  // The rectangles overlap while they overlap on both axes
+  int64_t entry = max(xEntry, yEntry);
+  int64_t exit = min(xExit, yExit);
+
+  if (entry >= exit || exit <= 0 || entry > 0x10000)
+    return false;
+
+  if (entry < 0)
+  {
+    hit.time = 0;
+    hit.normalX = 0;
+    hit.normalY = 0;
+    return true;
+  }
+
+  hit.time = entry;
+  hit.normalX = (xEntry == entry) ? ((dx > 0) ? -1 : 1) : 0;
+  hit.normalY = (yEntry == entry) ? ((dy > 0) ? -1 : 1) : 0;
+  return true;
+}
+
+bool sweepRects(const Rect &rect, int32_t dx, int32_t dy, const Rect *obstacles, uint16_t count, SweepHit &hit)
+{
+  // The area covered by the movement, rounded out to whole pixels
+  int x0 = rect.x + min(dx >> 16, 0);
+  int y0 = rect.y + min(dy >> 16, 0);
+  int x1 = rect.x + rect.width + max((dx + 0xFFFF) >> 16, 0);
+  int y1 = rect.y + rect.height + max((dy + 0xFFFF) >> 16, 0);
+  bool found = false;
+  SweepHit candidate;
+
+  for (uint16_t i = 0; i < count; i++)
+  {
+    const Rect &obstacle = obstacles[i];
+
+    // Obstacles just touching the area can still be hit at the very start or
+    // end of the movement
+    if (obstacle.x > x1 || obstacle.x + obstacle.width < x0 ||
+        obstacle.y > y1 || obstacle.y + obstacle.height < y0)
+      continue;
+
+    if (sweepRect(rect, dx, dy, obstacle, candidate) && (!found || candidate.time < hit.time))
+    {
+      hit = candidate;
+      hit.index = i;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+//========================================
+//========== Tile map collision ==========
+//========================================
+
+static int floorDiv(int a, int b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// The flags of the tile in a cell, with no flags outside the map
+static uint8_t cellFlags(const TileMap &map, int column, int row, uint16_t *cell = NULL)
+{
+  const Tileset &tileset = *map.tileset;
+
+  if (tileset.flags == NULL || column < 0 || column >= map.width || row < 0 || row >= map.height)
+    return 0;
+
+  uint16_t value = map.cells[row * map.width + column];
+  uint16_t index = value & TILE_INDEX_MASK;
+
+  if (index >= tileset.tileCount)
+    return 0;
+
+  if (cell != NULL)
+    *cell = value;
+
+  return tileset.flags[index];
+}
+
+// Whether any tile from column0 to column1 and row0 to row1 (inclusive) is
+// solid
+static bool anySolid(const TileMap &map, int column0, int row0, int column1, int row1)
+{
+  // Only the part inside the map can hold solid tiles
+  column0 = max(column0, 0);
+  row0 = max(row0, 0);
+  column1 = min(column1, map.width - 1);
+  row1 = min(row1, map.height - 1);
+
+  if (map.tileset->flags == NULL)
+    return false;
+
+  for (int row = row0; row <= row1; row++)
+  {
+    const uint16_t *cell = map.cells + row * map.width + column0;
+
+    for (int column = column0; column <= column1; column++, cell++)
+    {
+      uint16_t index = *cell & TILE_INDEX_MASK;
+
+      if (index < map.tileset->tileCount && (map.tileset->flags[index] & TILE_SOLID))
+        return true;
+    }
+  }
+
+  return false;
+}
+
+bool tileMapSolid(const TileMap &map, const Rect &rect)
+{
+  if (rect.width == 0 || rect.height == 0)
+    return false;
+
+  int tw = map.tileset->tileWidth;
+  int th = map.tileset->tileHeight;
+
+  return anySolid(map,
+    floorDiv(rect.x, tw), floorDiv(rect.y, th),
+    floorDiv(rect.x + rect.width - 1, tw), floorDiv(rect.y + rect.height - 1, th));
+}
+
+// Sweep along one axis: `lead` is the leading edge of the rectangle
+// (exclusive when moving forward), and the rectangle covers span0 to span1
+// (inclusive) across the axis. Tiles are `size` long along the axis and
+// `across` wide.
+static int16_t sweepTiles(const TileMap &map, bool vertical, int lead, int span0, int span1, int size, int across, int16_t distance)
+{
+  int first = floorDiv(span0, across);
+  int last = floorDiv(span1, across);
+
+  if (distance > 0)
+  {
+    int end = floorDiv(lead + distance - 1, size);
+
+    for (int line = floorDiv(lead, size); line <= end; line++)
+    {
+      if (vertical ? anySolid(map, first, line, last, line) : anySolid(map, line, first, line, last))
+        return max(line * size - lead, 0);
+    }
+  }
+  else if (distance < 0)
+  {
+    int end = floorDiv(lead + distance, size);
+
+    for (int line = floorDiv(lead - 1, size); line >= end; line--)
+    {
+      if (vertical ? anySolid(map, first, line, last, line) : anySolid(map, line, first, line, last))
+        return min((line + 1) * size - lead, 0);
+    }
+  }
+
+  return distance;
+}
+
+int16_t sweepTileMapX(const TileMap &map, const Rect &rect, int16_t dx)
+{
+  if (rect.height == 0)
+    return dx;
+
+  int lead = (dx > 0) ? rect.x + rect.width : rect.x;
+  return sweepTiles(map, false, lead, rect.y, rect.y + rect.height - 1, map.tileset->tileWidth, map.tileset->tileHeight, dx);
+}
+
+int16_t sweepTileMapY(const TileMap &map, const Rect &rect, int16_t dy)
+{
+  if (rect.width == 0)
+    return dy;
+
+  int lead = (dy > 0) ? rect.y + rect.height : rect.y;
+  return sweepTiles(map, true, lead, rect.x, rect.x + rect.width - 1, map.tileset->tileHeight, map.tileset->tileWidth, dy);
+}
+
+int16_t tileMapSurface(const TileMap &map, int16_t x, int16_t y)
+{
+  int tw = map.tileset->tileWidth;
+  int th = map.tileset->tileHeight;
+  int column = floorDiv(x, tw);
+  int row = floorDiv(y, th);
+  int top = row * th;
+  uint16_t cell = 0;
+  uint8_t flags = cellFlags(map, column, row, &cell);
+
+  if (flags & TILE_SOLID)
+    return top;
+
+  if (!(flags & (TILE_SLOPE_UP | TILE_SLOPE_DOWN)))
+    return top + th;
+
+  // The number of solid pixels at the column, counting the whole last one
+  int offset = x - column * tw;
+  bool rising = (flags & TILE_SLOPE_UP) != 0;
+
+  if (cell & TILE_FLIP_X)
+    rising = !rising;
+
+  int height = rising ? (offset + 1) * th / tw : (tw - offset) * th / tw;
+  return top + th - height;
+}
+
+bool raycastTileMap(const TileMap &map, Point from, Point to, TileHit &hit)
+{
+  int tw = map.tileset->tileWidth;
+  int th = map.tileset->tileHeight;
+  int column = floorDiv(from.x, tw);
+  int row = floorDiv(from.y, th);
+
+  hit.time = 0;
+  hit.normalX = 0;
+  hit.normalY = 0;
+
+  if (cellFlags(map, column, row) & TILE_SOLID)
+  {
+    hit.column = column;
+    hit.row = row;
+    return true;
+  }
+
+  // Step from tile to tile, taking whichever of the next column or row
+  // boundary the line reaches first. The line runs between pixel centers, so
+  // distances are in half pixels, and times are 16.16 fractions of the line.
+  int dx = to.x - from.x;
+  int dy = to.y - from.y;
+  int stepX = (dx > 0) ? 1 : -1;
+  int stepY = (dy > 0) ? 1 : -1;
+  int32_t nextX = INT32_MAX, deltaX = 0;
+  int32_t nextY = INT32_MAX, deltaY = 0;
+
+  if (dx != 0)
+  {
+    int distance = (dx > 0) ? 2 * (column + 1) * tw - (2 * from.x + 1) : (2 * from.x + 1) - 2 * column * tw;
+    nextX = ((int32_t)distance << 15) / abs(dx);
+    deltaX = ((int32_t)tw << 16) / abs(dx);
+  }
+
+  if (dy != 0)
+  {
+    int distance = (dy > 0) ? 2 * (row + 1) * th - (2 * from.y + 1) : (2 * from.y + 1) - 2 * row * th;
+    nextY = ((int32_t)distance << 15) / abs(dy);
+    deltaY = ((int32_t)th << 16) / abs(dy);
+  }
+
+  while (true)
+  {
+    if (nextX <= nextY)
+    {
+      if (nextX > 0x10000)
+        return false;
+
+      column += stepX;
+      hit.time = nextX;
+      hit.normalX = -stepX;
+      hit.normalY = 0;
+      nextX += deltaX;
+    }
+    else
+    {
+      if (nextY > 0x10000)
+        return false;
+
+      row += stepY;
+      hit.time = nextY;
+      hit.normalX = 0;
+      hit.normalY = -stepY;
+      nextY += deltaY;
+    }
+
+    if (cellFlags(map, column, row) & TILE_SOLID)
+    {
+      hit.column = column;
+      hit.row = row;
+      return true;
+    }
+  }
+}
+
+//=========================================
+//========== class CollisionGrid ==========
+//=========================================
+
+// The range of cells to search for objects that may overlap a rectangle
+struct CellRange
+{
+  int column0;
+  int row0;
+  int column1;
+  int row1;
+};
+
+static int cellColumn(const CollisionGrid &grid, int x)
+{
+  int column = (x - grid.originX) >> grid.cellShift;
+  return constrain(column, 0, grid.columns - 1);
+}
+
+static int cellRow(const CollisionGrid &grid, int y)
+{
+  int row = (y - grid.originY) >> grid.cellShift;
+  return constrain(row, 0, grid.rows - 1);
+}
+
+static uint16_t cellOf(const CollisionGrid &grid, const Rect &rect)
+{
+  return cellRow(grid, rect.y) * grid.columns + cellColumn(grid, rect.x);
+}
+
+static CellRange cellRange(const CollisionGrid &grid, const Rect &rect)
+{
+  // Objects are filed by their top left corner, so one that overlaps the
+  // rectangle can start up to the largest object size above or left of it
+  CellRange range;
+  range.column0 = cellColumn(grid, rect.x - grid.maxWidth);
+  range.row0 = cellRow(grid, rect.y - grid.maxHeight);
+  range.column1 = cellColumn(grid, rect.x + rect.width);
+  range.row1 = cellRow(grid, rect.y + rect.height);
+  return range;
+}
+
+static void unlinkObject(CollisionGrid &grid, uint16_t id)
+{
+  uint16_t *link = &grid.cells[grid.objects[id].cell];
+
+  while (*link != id)
+    link = &grid.objects[*link].next;
+
+  *link = grid.objects[id].next;
+  grid.objects[id].cell = GRID_NONE;
+}
+
+static void linkObject(CollisionGrid &grid, uint16_t id, uint16_t cell)
+{
+  grid.objects[id].next = grid.cells[cell];
+  grid.objects[id].cell = cell;
+  grid.cells[cell] = id;
+}
+
+CollisionGrid::CollisionGrid(GridObject *objects, uint16_t capacity, uint16_t *cells, uint8_t columns, uint8_t rows, uint8_t cellShift, int16_t originX, int16_t originY)
+ : objects(objects), cells(cells), capacity(capacity), columns(columns), rows(rows), cellShift(cellShift), originX(originX), originY(originY)
+{
+  clear();
+}
+
+void CollisionGrid::clear()
+{
+  for (uint16_t i = 0; i < columns * rows; i++)
+    cells[i] = GRID_NONE;
+
+  for (uint16_t i = 0; i < capacity; i++)
+    objects[i].cell = GRID_NONE;
+
+  maxWidth = 0;
+  maxHeight = 0;
+}
+
+bool CollisionGrid::insert(uint16_t id, const Rect &rect)
+{
+  return move(id, rect);
+}
+
+bool CollisionGrid::move(uint16_t id, const Rect &rect)
+{
+  if (id >= capacity)
+    return false;
+
+  GridObject &object = objects[id];
+  uint16_t cell = cellOf(*this, rect);
+
+  if (object.cell != cell)
+  {
+    if (object.cell != GRID_NONE)
+      unlinkObject(*this, id);
+
+    linkObject(*this, id, cell);
+  }
+
+  object.rect = rect;
+  maxWidth = max(maxWidth, rect.width);
+  maxHeight = max(maxHeight, rect.height);
+  return true;
+}
+
+void CollisionGrid::remove(uint16_t id)
+{
+  if (contains(id))
+    unlinkObject(*this, id);
+}
+
+bool CollisionGrid::contains(uint16_t id) const
+{
+  return id < capacity && objects[id].cell != GRID_NONE;
+}
+
+uint16_t CollisionGrid::query(const Rect &rect, uint16_t *ids, uint16_t maxIds) const
+{
+  CellRange range = cellRange(*this, rect);
+  uint16_t count = 0;
+
+  for (int row = range.row0; row <= range.row1; row++)
+  {
+    for (int column = range.column0; column <= range.column1; column++)
+    {
+      for (uint16_t id = cells[row * columns + column]; id != GRID_NONE; id = objects[id].next)
+      {
+        if (!overlaps(rect, objects[id].rect))
+          continue;
+
+        if (count == maxIds)
+          return count;
+
+        ids[count++] = id;
+      }
+    }
+  }
+
+  return count;
+}
+
+uint16_t CollisionGrid::findPairs(CollisionPair *pairs, uint16_t maxPairs) const
+{
+  uint16_t count = 0;
+
+  for (uint16_t a = 0; a < capacity; a++)
+  {
+    if (objects[a].cell == GRID_NONE)
+      continue;
+
+    const Rect &rect = objects[a].rect;
+    CellRange range = cellRange(*this, rect);
+
+    // Only pair with higher IDs, so that each pair is found once
+    for (int row = range.row0; row <= range.row1; row++)
+    {
+      for (int column = range.column0; column <= range.column1; column++)
+      {
+        for (uint16_t b = cells[row * columns + column]; b != GRID_NONE; b = objects[b].next)
+        {
+          if (b <= a || !overlaps(rect, objects[b].rect))
+            continue;
+
+          if (count == maxPairs)
+            return count;
+
+          pairs[count].a = a;
+          pairs[count].b = b;
+          count++;
+        }
+      }
+    }
+  }
+
+  return count;
+}
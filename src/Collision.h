@@ -0,0 +1,490 @@
+/**
+ * @file Collision.h
+ * \brief
+ * Collision detection for many objects at a time.
+ *
+ * \details
+ * `DotMGBase::collide()` tests a single pair of objects. The definitions here
+ * find collisions among many objects without testing every pair. They don't
+ * allocate memory: storage is provided by the sketch.
+ */
+
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <Arduino.h>
+#include "DotMG.h"
+
+// An empty cell or object link in a CollisionGrid
+#define GRID_NONE 0xFFFF
+
+//=======================================
+//========== GridObject object ==========
+//=======================================
+
+/** \brief
+ * The storage for one object in a `CollisionGrid`.
+ *
+ * \details
+ * A grid needs an array of these, one per object ID. Its contents are
+ * maintained by the grid.
+ */
+struct GridObject
+{
+  Rect rect;     /**< The bounds of the object */
+  uint16_t next; /**< The next object in the same cell, or `GRID_NONE` */
+  uint16_t cell; /**< The cell the object is in, or `GRID_NONE` if not in the grid */
+};
+
+//==========================================
+//========== CollisionPair object ==========
+//==========================================
+
+/** \brief
+ * Two colliding objects found by `CollisionGrid::findPairs()`.
+ */
+struct CollisionPair
+{
+  uint16_t a; /**< The lower ID of the two */
+  uint16_t b; /**< The higher ID of the two */
+};
+
+//=======================================
+//========== RectArrays object ==========
+//=======================================
+
+/** \brief
+ * Many rectangles stored as separate arrays of coordinates and sizes.
+ *
+ * \details
+ * Keeping each field in its own array (rather than an array of `Rect`) lets
+ * `collideRects()` and `findCollisions()` test rectangles in a tight loop.
+ * The arrays are not copied.
+ */
+struct RectArrays
+{
+  const int16_t *x;       /**< The X coordinates of the top left corners */
+  const int16_t *y;       /**< The Y coordinates of the top left corners */
+  const uint16_t *width;  /**< The widths */
+  const uint16_t *height; /**< The heights */
+  uint16_t count;         /**< The number of rectangles */
+};
+
+/** \brief
+ * Test a rectangle against many rectangles, marking the ones it intersects.
+ *
+ * \param rect The rectangle to test.
+ * \param rects The rectangles to test it against.
+ * \param hits The array that receives one bit per rectangle, `(rects.count +
+ * 31) / 32` words of them. Bit `i % 32` of word `i / 32` is set if `rect`
+ * intersects rectangle `i`.
+ *
+ * \return The number of rectangles `rect` intersects.
+ *
+ * \details
+ * Each test is the same as `DotMGBase::collide(Rect, Rect)`, without
+ * branches.
+ */
+uint16_t collideRects(const Rect &rect, const RectArrays &rects, uint32_t *hits);
+
+/** \brief
+ * Test a point against many rectangles, marking the ones it falls within.
+ *
+ * \param point The point to test.
+ * \param rects The rectangles to test it against.
+ * \param hits The array that receives one bit per rectangle, as for
+ * `collideRects(const Rect&, const RectArrays&, uint32_t*)`.
+ *
+ * \return The number of rectangles the point falls within.
+ */
+uint16_t collideRects(const Point &point, const RectArrays &rects, uint32_t *hits);
+
+/** \brief
+ * Find the rectangles that a rectangle intersects.
+ *
+ * \param rect The rectangle to test.
+ * \param rects The rectangles to test it against.
+ * \param indexes The array that receives the indexes of the intersected
+ * rectangles, in increasing order.
+ * \param maxIndexes The number of elements in `indexes`.
+ *
+ * \return The number of indexes stored. The search stops when `indexes` is
+ * full.
+ */
+uint16_t findCollisions(const Rect &rect, const RectArrays &rects, uint16_t *indexes, uint16_t maxIndexes);
+
+/** \brief
+ * Find the rectangles that a point falls within.
+ *
+ * \param point The point to test.
+ * \param rects The rectangles to test it against.
+ * \param indexes The array that receives the indexes of the rectangles, in
+ * increasing order.
+ * \param maxIndexes The number of elements in `indexes`.
+ *
+ * \return The number of indexes stored. The search stops when `indexes` is
+ * full.
+ */
+uint16_t findCollisions(const Point &point, const RectArrays &rects, uint16_t *indexes, uint16_t maxIndexes);
+
+//==========================================
+//========== CollisionMask object ==========
+//==========================================
+
+/** \brief
+ * The solid pixels of an image, one bit per pixel, for pixel accurate
+ * collisions.
+ *
+ * \details
+ * Each row is `(width + 31) / 32` words, and bit 0 of a word is the leftmost
+ * of its 32 pixels. Bits past the width must be clear.
+ *
+ * Masks are usually created along with an image by `extras/img2dotmg.py`
+ * with the `--mask` option, or at run time by `makeCollisionMask()`.
+ */
+struct CollisionMask
+{
+  const uint32_t *bits; /**< The rows of bits */
+  uint16_t width;       /**< The width in pixels */
+  uint16_t height;      /**< The height in pixels */
+};
+
+/** \brief
+ * Make a collision mask from the alpha of a bitmap.
+ *
+ * \param bitmap The bitmap, as for `DotMGBase::drawBitmap()`.
+ * \param width The width of the bitmap.
+ * \param height The height of the bitmap.
+ * \param bits The array that receives the bits, `height * ((width + 31) /
+ * 32)` words of them.
+ * \param minAlpha The lowest alpha, from 1 to 15, of a solid pixel
+ * (optional; defaults to 1).
+ *
+ * \return The mask, which uses `bits`.
+ */
+CollisionMask makeCollisionMask(const Color *bitmap, uint16_t width, uint16_t height, uint32_t *bits, uint8_t minAlpha = 1);
+
+/** \brief
+ * Test if the solid pixels of two masks overlap.
+ *
+ * \param maskA The first mask.
+ * \param posA The location of the top left corner of the first mask.
+ * \param maskB The second mask.
+ * \param posB The location of the top left corner of the second mask.
+ *
+ * \return `true` if a solid pixel of one mask is on a solid pixel of the
+ * other.
+ *
+ * \details
+ * Only the rows where the masks' bounding rectangles intersect are tested,
+ * 32 pixels at a time, so it's cheap to call when the rectangles don't
+ * intersect at all.
+ */
+bool collideMasks(const CollisionMask &maskA, Point posA, const CollisionMask &maskB, Point posB);
+
+//=====================================
+//========== SweepHit object ==========
+//=====================================
+
+/** \brief
+ * Where a moving rectangle first touches another, found by `sweepRect()` or
+ * `sweepRects()`.
+ */
+struct SweepHit
+{
+  int32_t time;   /**< The fraction of the movement before contact, in 16.16 fixed point: 0 to `0x10000` */
+  int8_t normalX; /**< -1 if the rectangle hit something to its right, 1 if to its left, otherwise 0 */
+  int8_t normalY; /**< -1 if the rectangle hit something below it, 1 if above it, otherwise 0 */
+  uint16_t index; /**< With `sweepRects()`, the index of the rectangle that was hit */
+};
+
+/** \brief
+ * Find when a moving rectangle first touches another rectangle.
+ *
+ * \param rect The moving rectangle, at its starting location.
+ * \param dx The horizontal movement, in 16.16 fixed point pixels.
+ * \param dy The vertical movement, in 16.16 fixed point pixels.
+ * \param obstacle The rectangle that isn't moving.
+ * \param hit Receives the time of contact and the contact normal.
+ *
+ * \return `true` if the rectangles touch during the movement.
+ *
+ * \details
+ * Unlike testing for overlap at the end of the movement, a fast rectangle
+ * can't pass through a thin one. Moving by `(int64_t)dx * time >> 16` and
+ * `(int64_t)dy * time >> 16` brings `rect` up against `obstacle` without
+ * overlapping it. The normal
+ * points back along the axis of contact, so sliding along a wall is a matter
+ * of moving the rest of the way with that axis' movement removed. At an
+ * exact corner both components of the normal are set.
+ *
+ * A rectangle already touching `obstacle` and moving into it is hit at time
+ * 0. A rectangle that already overlaps `obstacle` is also hit at time 0, with
+ * a zero normal.
+ */
+bool sweepRect(const Rect &rect, int32_t dx, int32_t dy, const Rect &obstacle, SweepHit &hit);
+
+/** \brief
+ * Find which of many rectangles a moving rectangle touches first.
+ *
+ * \param rect The moving rectangle, at its starting location.
+ * \param dx The horizontal movement, in 16.16 fixed point pixels.
+ * \param dy The vertical movement, in 16.16 fixed point pixels.
+ * \param obstacles The rectangles that aren't moving.
+ * \param count The number of obstacles.
+ * \param hit Receives the earliest contact, as for `sweepRect()`, and the
+ * index of the obstacle.
+ *
+ * \return `true` if `rect` touches any of the obstacles during the movement.
+ *
+ * \details
+ * Obstacles away from the area covered by the movement are rejected before
+ * any division. Of obstacles touched at the same time, the first in the
+ * array is reported.
+ */
+bool sweepRects(const Rect &rect, int32_t dx, int32_t dy, const Rect *obstacles, uint16_t count, SweepHit &hit);
+
+//====================================
+//========== TileHit object ==========
+//====================================
+
+/** \brief
+ * The first solid tile along a ray, found by `raycastTileMap()`.
+ */
+struct TileHit
+{
+  int16_t column; /**< The column of the tile */
+  int16_t row;    /**< The row of the tile */
+  int32_t time;   /**< The fraction of the ray before the tile, in 16.16 fixed point: 0 to `0x10000` */
+  int8_t normalX; /**< -1 if the ray entered the tile through its left side, 1 through its right side, otherwise 0 */
+  int8_t normalY; /**< -1 if the ray entered the tile through its top, 1 through its bottom, otherwise 0 */
+};
+
+// Tile map collision
+//
+// These use the flag table of the map's tileset: tiles with `TILE_SOLID`
+// block movement, and `TILE_SLOPE_UP` and `TILE_SLOPE_DOWN` tiles have a
+// sloped floor (see `tileMapSurface()`). A tile with `TILE_FLIP_X` in its
+// map cell has its slope reversed; other orientation bits are ignored.
+// Coordinates are in pixels from the top left corner of the map, and
+// everything outside the map is empty. Tiles are found by their column and
+// row, so the cost of a query is the number of tiles it covers.
+
+/** \brief
+ * Test if a rectangle overlaps any solid tile.
+ *
+ * \param map The tile map.
+ * \param rect The rectangle, in map pixels.
+ *
+ * \return `true` if a `TILE_SOLID` tile overlaps `rect`.
+ */
+bool tileMapSolid(const TileMap &map, const Rect &rect);
+
+/** \brief
+ * Find how far a rectangle can move horizontally before touching a solid
+ * tile.
+ *
+ * \param map The tile map.
+ * \param rect The rectangle, in map pixels.
+ * \param dx How far to move: negative to move left.
+ *
+ * \return The distance the rectangle can move, from 0 to `dx`. It is 0 if
+ * the rectangle already overlaps a solid tile on that side.
+ *
+ * \details
+ * This is the usual way to move a platformer character: horizontally, then
+ * vertically with `sweepTileMapY()`.
+ */
+int16_t sweepTileMapX(const TileMap &map, const Rect &rect, int16_t dx);
+
+/** \brief
+ * Find how far a rectangle can move vertically before touching a solid tile.
+ *
+ * \param map The tile map.
+ * \param rect The rectangle, in map pixels.
+ * \param dy How far to move: negative to move up.
+ *
+ * \return The distance the rectangle can move, from 0 to `dy`. It is 0 if
+ * the rectangle already overlaps a solid tile on that side.
+ */
+int16_t sweepTileMapY(const TileMap &map, const Rect &rect, int16_t dy);
+
+/** \brief
+ * Find the top of the solid part of a tile at a pixel column.
+ *
+ * \param map The tile map.
+ * \param x The X coordinate, in map pixels.
+ * \param y The Y coordinate, in map pixels, of any point in the tile.
+ *
+ * \return The Y coordinate of the top of the solid part of the tile at
+ * column `x`, or of the bottom of the tile if it has no solid part.
+ *
+ * \details
+ * For a `TILE_SOLID` tile this is the top of the tile. For a slope it is the
+ * height of the slope at `x`, rising a tile height over a tile width. A
+ * character whose feet are at `x`, `y` is standing in the floor when `y` is
+ * at or below the result, and can be moved up onto it.
+ */
+int16_t tileMapSurface(const TileMap &map, int16_t x, int16_t y);
+
+/** \brief
+ * Find the first solid tile along a line.
+ *
+ * \param map The tile map.
+ * \param from The start of the line, in map pixels.
+ * \param to The end of the line, in map pixels.
+ * \param hit Receives the tile, how far along the line it starts, and the
+ * side of the tile that was hit.
+ *
+ * \return `true` if a `TILE_SOLID` tile is on the line.
+ *
+ * \details
+ * The line runs from the center of pixel `from` to the center of pixel `to`.
+ * Tiles are visited in order along it, stepping from one tile to the next
+ * without division, so the cost is the number of tiles crossed. A line
+ * starting in a solid tile hits it at time 0, with a zero normal.
+ */
+bool raycastTileMap(const TileMap &map, Point from, Point to, TileHit &hit);
+
+//==========================================
+//========== CollisionGrid object ==========
+//==========================================
+
+/** \brief
+ * A uniform grid for finding which of many rectangles overlap.
+ *
+ * \details
+ * The area of the game world is divided into square cells, each with a list
+ * of the objects whose top left corner is in it. A query then only tests the
+ * objects in the cells around the queried rectangle, rather than every
+ * object. Objects outside the area are kept in the cells at its edges, so
+ * they are still found, just less quickly.
+ *
+ * Objects are identified by an ID from 0 to one less than the capacity,
+ * usually the index of the object in the sketch's own arrays. Cells work
+ * best when they are about the size of the larger objects: objects much
+ * larger than a cell make every query look at more cells.
+ *
+ * \code{.cpp}
+ * // 64 objects in a 256x128 world of 32x32 cells
+ * GridObject gridObjects[64];
+ * uint16_t gridCells[8 * 4];
+ * CollisionGrid grid(gridObjects, 64, gridCells, 8, 4, 5);
+ *
+ * grid.move(enemyId, enemyRect);
+ *
+ * uint16_t hits[8];
+ * uint16_t count = grid.query(bulletRect, hits, 8);
+ * \endcode
+ */
+struct CollisionGrid
+{
+  GridObject *objects; /**< The objects, indexed by ID */
+  uint16_t *cells;     /**< The first object in each cell, row by row */
+  uint16_t capacity;   /**< The number of elements in `objects` */
+  uint8_t columns;     /**< The number of columns of cells */
+  uint8_t rows;        /**< The number of rows of cells */
+  uint8_t cellShift;   /**< The cell size is 1 << `cellShift` pixels */
+  int16_t originX;     /**< The X coordinate of the left of the grid */
+  int16_t originY;     /**< The Y coordinate of the top of the grid */
+  uint16_t maxWidth;   /**< The width of the widest object added since the grid was cleared */
+  uint16_t maxHeight;  /**< The height of the tallest object added since the grid was cleared */
+
+  /** \brief
+   * The default constructor
+   */
+  CollisionGrid() = default;
+
+  /** \brief
+   * The initializing constructor, which also clears the grid.
+   *
+   * \param objects Storage for the objects, `capacity` of them.
+   * \param capacity The number of objects, and one more than the largest ID.
+   * \param cells Storage for the cells, `columns` * `rows` of them.
+   * \param columns The number of columns of cells.
+   * \param rows The number of rows of cells.
+   * \param cellShift The size of a cell as a power of two: 5 for 32x32 pixel
+   * cells, for example.
+   * \param originX The X coordinate of the left of the grid (optional;
+   * defaults to 0).
+   * \param originY The Y coordinate of the top of the grid (optional;
+   * defaults to 0).
+   */
+  CollisionGrid(GridObject *objects, uint16_t capacity, uint16_t *cells, uint8_t columns, uint8_t rows, uint8_t cellShift, int16_t originX = 0, int16_t originY = 0);
+
+  /** \brief
+   * Remove all objects.
+   */
+  void clear();
+
+  /** \brief
+   * Add an object, or move it if it's already in the grid.
+   *
+   * \param id The ID of the object.
+   * \param rect The bounds of the object.
+   *
+   * \return `false` if the ID is not less than the capacity.
+   */
+  bool insert(uint16_t id, const Rect &rect);
+
+  /** \brief
+   * Change the bounds of an object, adding it if it isn't in the grid.
+   *
+   * \param id The ID of the object.
+   * \param rect The new bounds of the object.
+   *
+   * \return `false` if the ID is not less than the capacity.
+   *
+   * \details
+   * Moving within the same cell only updates the bounds.
+   */
+  bool move(uint16_t id, const Rect &rect);
+
+  /** \brief
+   * Remove an object.
+   *
+   * \param id The ID of the object. Nothing happens if it isn't in the grid.
+   */
+  void remove(uint16_t id);
+
+  /** \brief
+   * Test if an object is in the grid.
+   *
+   * \param id The ID of the object.
+   *
+   * \return `true` if the object was added and not removed since.
+   */
+  bool contains(uint16_t id) const;
+
+  /** \brief
+   * Find the objects that overlap a rectangle.
+   *
+   * \param rect The rectangle to test.
+   * \param ids The array that receives the IDs of the overlapping objects.
+   * \param maxIds The number of elements in `ids`.
+   *
+   * \return The number of IDs stored in `ids`. The query stops when `ids` is
+   * full.
+   *
+   * \details
+   * Overlap is tested as by `DotMGBase::collide(Rect, Rect)`. An object in
+   * the grid is found by a query of its own bounds.
+   */
+  uint16_t query(const Rect &rect, uint16_t *ids, uint16_t maxIds) const;
+
+  /** \brief
+   * Find all pairs of overlapping objects.
+   *
+   * \param pairs The array that receives the pairs.
+   * \param maxPairs The number of elements in `pairs`.
+   *
+   * \return The number of pairs stored in `pairs`. The search stops when
+   * `pairs` is full.
+   *
+   * \details
+   * Each pair is reported once.
+   */
+  uint16_t findPairs(CollisionPair *pairs, uint16_t maxPairs) const;
+};
+
+#endif
@@ -143,7 +143,7 @@ public:
    */
   Color grayscale() const
   {
-    uint8_t v = (0.3f*r() + 0.59f*g() + 0.11f*b());
+    uint8_t v = (30*r() + 59*g() + 11*b()) / 100;
     return Color(v, v, v, a());
   }
 
@@ -25,6 +25,113 @@ Point::Point(int16_t x, int16_t y)
 {
 }
 
+Point::Point(const FixedVector &v)
+ : x(v.x.toInt()), y(v.y.toInt())
+{
+}
+
+//===================================
+//========== class Surface ==========
+//===================================
+
+Surface::Surface(Color *pixels, uint16_t width, uint16_t height, uint16_t stride)
+ : pixels(pixels), width(width), height(height), stride(stride ? stride : width)
+{
+}
+
+Surface Surface::subsurface(int16_t x, int16_t y, uint16_t w, uint16_t h) const
+{
+  int x0 = max(x, 0), y0 = max(y, 0);
+  int x1 = min(x + w, (int)width), y1 = min(y + h, (int)height);
+
+  if (x0 >= x1 || y0 >= y1)
+    return Surface(pixels, 0, 0, stride);
+
+  return Surface(pixels + y0*stride + x0, x1 - x0, y1 - y0, stride);
+}
+
+//=====================================
+//========== class TextCache ==========
+//=====================================
+
+TextCache::TextCache(Color *pixels, uint16_t width, uint16_t height)
+ : surface(pixels, width, height), blend(NULL), bgBlend(NULL), size(0), left(0), top(0), width(0), height(0)
+{
+  text[0] = '\0';
+}
+
+void TextCache::invalidate()
+{
+  size = 0;
+}
+
+//========================================
+//========== class AffineMatrix ==========
+//========================================
+
+AffineMatrix AffineMatrix::identity()
+{
+  return scaling(0x10000, 0x10000);
+}
+
+AffineMatrix AffineMatrix::translation(int16_t x, int16_t y)
+{
+  AffineMatrix m = identity();
+  m.tx = (int32_t)x * 0x10000;
+  m.ty = (int32_t)y * 0x10000;
+  return m;
+}
+
+AffineMatrix AffineMatrix::scaling(int32_t sx, int32_t sy)
+{
+  AffineMatrix m = {sx, 0, 0, sy, 0, 0};
+  return m;
+}
+
+AffineMatrix AffineMatrix::rotation(float radians)
+{
+  // 0x10000 / (2 * pi) angle units per radian
+  return rotationAngle((int32_t)(radians * 10430.378f));
+}
+
+AffineMatrix AffineMatrix::rotationAngle(Angle angle)
+{
+  int32_t cosine = fixedCos(angle).raw;
+  int32_t sine = fixedSin(angle).raw;
+  AffineMatrix m = {cosine, -sine, sine, cosine, 0, 0};
+  return m;
+}
+
+AffineMatrix AffineMatrix::inverse() const
+{
+  AffineMatrix m = {0, 0, 0, 0, 0, 0};
+  int64_t det = (int64_t)a*d - (int64_t)b*c;  // 32.32 fixed point
+
+  if (det == 0)
+    return m;
+
+  m.a = ((int64_t)d * 0x100000000LL) / det;
+  m.b = -((int64_t)b * 0x100000000LL) / det;
+  m.c = -((int64_t)c * 0x100000000LL) / det;
+  m.d = ((int64_t)a * 0x100000000LL) / det;
+  m.tx = -(((int64_t)m.a*tx + (int64_t)m.b*ty) >> 16);
+  m.ty = -(((int64_t)m.c*tx + (int64_t)m.d*ty) >> 16);
+  return m;
+}
+
+AffineMatrix AffineMatrix::operator*(const AffineMatrix &o) const
+{
+  AffineMatrix m = {
+    (int32_t)(((int64_t)a*o.a + (int64_t)b*o.c) >> 16),
+    (int32_t)(((int64_t)a*o.b + (int64_t)b*o.d) >> 16),
+    (int32_t)(((int64_t)c*o.a + (int64_t)d*o.c) >> 16),
+    (int32_t)(((int64_t)c*o.b + (int64_t)d*o.d) >> 16),
+    (int32_t)((((int64_t)a*o.tx + (int64_t)b*o.ty) >> 16) + tx),
+    (int32_t)((((int64_t)c*o.tx + (int64_t)d*o.ty) >> 16) + ty)
+  };
+  return m;
+}
+
 //========================================
 //========== class DotMGBase ==========
 //========================================
@@ -35,6 +142,9 @@ static uint8_t previousButtonState;
 static Color frameBuf[WIDTH*HEIGHT];
 static bool overlapAvoid;
 static bool *drawnPixels;
+static int overlapX0;
+static int overlapY0;
+static int overlapWidth;
 static uint16_t currFrame;
 static uint16_t eachFrameMillis = 16;
 static uint16_t thisFrameStart;
@@ -46,19 +156,133 @@ static Color *bgImage;
 static uint16_t bgImageWidth;
 static uint16_t bgImageHeight;
 static BlendFunc bgImageBlend;
+static const TileMap *bgMap;
+static int16_t bgMapX;
+static int16_t bgMapY;
 
 static int16_t cursor_x;
 static int16_t cursor_y;
 
-// Draw one or more "corners" of a circle.
-static void drawCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t corners, Color color = COLOR_WHITE, BlendFunc blend = BLEND_ALPHA);
+// Where drawing goes (see setDrawTarget())
+static Surface target(frameBuf, WIDTH, HEIGHT);
+
+// Compositing layers (see setLayer())
+struct Layer
+{
+  Surface surface;
+  int16_t scrollX;
+  int16_t scrollY;
+  uint8_t opacity;
+  bool visible;
+  bool above;
+};
+
+static Layer layers[DOTMG_LAYER_COUNT];
+
+// Per-scanline effects (see setScanlineCallback() and setScanlineOffsets())
+static ScanlineFunc scanlineFunc;
+static const int8_t *scanlineOffsets;
+static uint16_t scanlineLength;
+static uint16_t scanlinePhase;
+static Color shiftedRow[WIDTH];
+static uint16_t scanlineTable[3*16];
+
+// Screen-wide color effects (see setScreenFade(), setScreenTint() and setScreenFilter())
+static uint8_t screenFadeAmount;
+static Color screenFadeColor = COLOR_BLACK;
+static Color screenTintColor = COLOR_WHITE;
+static uint8_t screenFilter;
+static bool screenTableActive;
+static uint16_t screenTable[3*16];
+
+// Active view: clip rectangle (in screen coordinates, with exclusive right and
+// bottom edges) and drawing origin
+struct View
+{
+  int16_t clipX0;
+  int16_t clipY0;
+  int16_t clipX1;
+  int16_t clipY1;
+  int16_t originX;
+  int16_t originY;
+};
+
+static View view = {0, 0, WIDTH, HEIGHT, 0, 0};
+static View viewStack[DOTMG_VIEW_STACK_SIZE];
+static uint8_t viewDepth;
+
+// Deferred draw list, and the screen tiles it is binned into when flushed
+#define DRAW_TILE_COLUMNS ((WIDTH + DOTMG_DRAW_TILE_SIZE - 1) / DOTMG_DRAW_TILE_SIZE)
+#define DRAW_TILE_ROWS    ((HEIGHT + DOTMG_DRAW_TILE_SIZE - 1) / DOTMG_DRAW_TILE_SIZE)
+#define DRAW_BIN_WORDS    ((DOTMG_DRAW_LIST_SIZE + 31) / 32)
+
+static DrawCommand drawList[DOTMG_DRAW_LIST_SIZE];
+static uint16_t drawListCount;
+static uint16_t drawOrder[DOTMG_DRAW_LIST_SIZE];
+static uint32_t drawBins[DRAW_TILE_COLUMNS*DRAW_TILE_ROWS][DRAW_BIN_WORDS];
+
+// Sprite pool, and the IDs of the sprites in it in drawing order
+static Sprite sprites[DOTMG_SPRITE_CAPACITY];
+static uint16_t spriteOrder[DOTMG_SPRITE_CAPACITY];
+static uint16_t spriteOrderCount;
+
+// The visible part of a source image, and where and how it lands in the
+// frame buffer (see orientBlit())
+struct Blit
+{
+  int x;        // The visible part of the source, in source pixels
+  int y;
+  int width;
+  int height;
+  Color *dst;   // Where source pixel x, y lands
+  int colStep;  // Frame buffer distance between neighbors in a source row
+  int rowStep;  // Frame buffer distance between neighbors in a source column
+};
+
+// Results of clipTest()
+#define CLIP_OUTSIDE 0
+#define CLIP_PARTIAL 1
+#define CLIP_INSIDE  2
+
+// Draw one or more "corners" of a circle, centered at screen coordinates x0, y0.
+static void drawCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t corners, Color color, BlendFunc blend, bool clip);
 
 // Draw one or both vertical halves of a filled-in circle or rounded rectangle edge.
 static void fillCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t sides, int16_t delta, Color color = COLOR_WHITE, BlendFunc blend = BLEND_ALPHA);
 
 static void swap(int16_t &a, int16_t &b);
+static void swap(int &a, int &b);
 static Color blendBg(uint16_t x, uint16_t y) __attribute__((always_inline));
 
+static bool saveView();
+static void intersectClip(int x0, int y0, int x1, int y1);
+static inline bool clipToView(int &x0, int &y0, int &x1, int &y1) __attribute__((always_inline));
+static uint8_t clipTest(int x0, int y0, int x1, int y1);
+static inline void plotPixel(int x, int y, Color color, BlendFunc blend, bool clip) __attribute__((always_inline));
+static int lineMoves(int steps, int dx, int dy, int err);
+static int lineStepsBefore(int moves, int dx, int dy, int err);
+static void fillSpan(Color *dst, int count, int step, Color color, BlendFunc blend);
+static void fillClippedRect(int x0, int y0, int x1, int y1, Color color, BlendFunc blend);
+static void orientPixel(int &x, int &y, int w, int h, uint8_t flags);
+static void orientRect(int &x, int &y, int &rw, int &rh, int w, int h, uint8_t flags);
+static void unorientRect(int &x, int &y, int &rw, int &rh, int w, int h, uint8_t flags);
+static bool orientBlit(int bx, int by, int w, int h, uint8_t flags, Blit &blit);
+static void blitSpan(Color *dst, int step, const Color *src, int count, BlendFunc blend);
+static inline void copySpan(Color *dst, int step, const Color *src, int count) __attribute__((always_inline));
+static void blitBitmap(int bx, int by, const Color *bitmap, int stride, int w, int h, BlendFunc blend, uint8_t flags);
+static void clipAffineSpan(int64_t value, int32_t step, int32_t end, int &k0, int &k1);
+static void copyBitmap(int bx, int by, const Color *bitmap, int stride, int w, int h, uint8_t flags);
+static int floorDiv(int a, int b);
+static void drawTiles(const TileMap &map, int cameraX, int cameraY, BlendFunc blend, bool fillBackground);
+static void clearBackground();
+static void compositeSpan(Color *dst, const Color *src, int count, const uint8_t *alpha);
+static void compositeLayer(Color *row, const Layer &layer, int y);
+static void compositeRow(Color *row, int y);
+static void buildChannelTable(uint16_t table[], Color tint, uint8_t brightness);
+static const uint16_t* scanlineEffects(int y, const Color *&src);
+static void buildScreenTable();
+static void affineSpan(Color *dst, int count, const Color *bitmap, uint16_t w, int32_t u, int32_t v, int32_t du, int32_t dv, BlendFunc blend);
+
 void DotMGBase::begin()
 {
   boot();
@@ -78,11 +302,29 @@ Color blendBg(uint16_t x, uint16_t y)
   return bgImageBlend(bgImage[imgY*bgImageWidth + imgX], bgColor);
 }
 
+void clearBackground()
+{
+  // The background covers the whole screen, whatever the current view
+  View savedView = view;
+  Surface savedTarget = target;
+  view = View{0, 0, WIDTH, HEIGHT, 0, 0};
+  target = Surface(frameBuf, WIDTH, HEIGHT);
+  drawTiles(*bgMap, bgMapX, bgMapY, BLEND_ALPHA, true);
+  view = savedView;
+  target = savedTarget;
+}
+
 void DotMGBase::clear()
 {
   cursor_x = 0;
   cursor_y = 0;
 
+  if (bgMap != NULL)
+  {
+    clearBackground();
+    return;
+  }
+
   for (int y = 0, yw = 0; y < HEIGHT; y++, yw += WIDTH)
   {
     for (int x = 0; x < WIDTH; x++)
@@ -94,24 +336,53 @@ void DotMGBase::clear()
 
 void DotMGBase::display(bool clear)
 {
+  flushDrawList();
+
   if (clear)
   {
     cursor_x = 0;
     cursor_y = 0;
   }
 
+  // A background tile map is redrawn after sending instead of pixel by pixel
+  bool clearPixels = clear && bgMap == NULL;
+  bool composite = false;
+  bool grayscale = screenFilter & SCREEN_GRAYSCALE;
+
+  for (uint8_t i = 0; i < DOTMG_LAYER_COUNT; i++)
+    composite |= (layers[i].surface.pixels != NULL && layers[i].visible);
+
   // Translate image to display stage
   for (int y = 0, yw = 0; y < HEIGHT; y++, yw += WIDTH)
   {
+    // With layers, each row is composited into a row buffer and sent from there
+    Color row[WIDTH];
+    const Color *src = frameBuf + yw;
+
+    if (composite)
+    {
+      compositeRow(row, y);
+      src = row;
+    }
+
+    // Colors are translated through per-channel tables on rows with effects
+    const uint16_t *table = scanlineEffects(y, src);
+
     for (int x = 0; x < WIDTH; x++)
     {
       int i_src = yw + x;
+      uint16_t c = src[x].value >> 4;  // Ignore alpha
+
+      if (grayscale)
+        c = (((c >> 8)*77 + ((c >> 4) & 0xF)*150 + (c & 0xF)*29) >> 8) * 0x111;
+
+      if (table != NULL)
+        c = table[c >> 8] | table[16 + ((c >> 4) & 0xF)] | table[32 + (c & 0xF)];
 
 #ifdef DOTMG_PIXEL_SIZE_2X
       int i_dst = 3*i_src + 3*yw;  // 2*3*yw + 3*x
-      uint16_t c = frameBuf[i_src] >> 4;  // Ignore alpha
 
-      if (clear)
+      if (clearPixels)
         frameBuf[i_src] = blendBg(x, y);
 
       // Add two adjacent 12-bit pixels of the same color
@@ -125,9 +396,8 @@ void DotMGBase::display(bool clear)
       stage[i_dst+2 + 3*WIDTH] = stage[i_dst+2];
 #else
       int i_dst = (i_src * 3) >> 1;
-      uint16_t c = frameBuf[i_src] >> 4;  // Ignore alpha
 
-      if (clear)
+      if (clearPixels)
         frameBuf[i_src] = blendBg(x, y);
 
       if (x & 0x1) // x odd
@@ -145,6 +415,9 @@ void DotMGBase::display(bool clear)
   }
 
   blit();
+
+  if (clear && bgMap != NULL)
+    clearBackground();
 }
 
 void DotMGBase::setBackgroundColor(Color color)
@@ -195,628 +468,2804 @@ BlendFunc DotMGBase::backgroundImageBlendFunc()
   return bgImageBlend;
 }
 
-void DotMGBase::drawPixel(int16_t x, int16_t y, Color color, BlendFunc blend)
+void DotMGBase::setBackgroundTileMap(const TileMap *map, int16_t cameraX, int16_t cameraY)
 {
-  if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
-    return;
+  bgMap = map;
+  bgMapX = cameraX;
+  bgMapY = cameraY;
+}
+
+const TileMap* DotMGBase::backgroundTileMap()
+{
+  return bgMap;
+}
 
-  int i = y*WIDTH + x;
+/* Scanline effects */
 
-  if (overlapAvoid)
+void buildChannelTable(uint16_t table[], Color tint, uint8_t brightness)
+{
+  uint8_t ta = tint.a();
+  uint8_t channels[3] = {tint.r(), tint.g(), tint.b()};
+
+  // One table of 16 values per channel, each already shifted into place
+  for (uint8_t ch = 0; ch < 3; ch++)
   {
-    if (!drawnPixels[i])
+    for (uint8_t v = 0; v < 16; v++)
     {
-      frameBuf[i] = blend(color, getPixel(x, y));
-      drawnPixels[i] = true;
+      uint16_t c = (v*(0xF - ta) + channels[ch]*ta + 7) / 0xF;
+      c = (c*brightness + 0x7F) / 0xFF;
+
+      // Screen-wide effects come after the row's own
+      table[ch*16 + v] = screenTableActive ? screenTable[ch*16 + c] : c << (8 - 4*ch);
     }
-    return;
   }
-
-  frameBuf[i] = blend(color, getPixel(x, y));
 }
 
-Color DotMGBase::getPixel(int16_t x, int16_t y)
+const uint16_t* scanlineEffects(int y, const Color *&src)
 {
-  if (x < 0 || x >= WIDTH || y < 0 || y >= HEIGHT)
-    return COLOR_CLEAR;
+  const uint16_t *screen = screenTableActive ? screenTable : NULL;
 
-  return frameBuf[y*WIDTH + x];
-}
+  if (scanlineFunc == NULL && scanlineOffsets == NULL)
+    return screen;
 
-void DotMGBase::drawCircle(int16_t x0, int16_t y0, uint16_t r, Color color, BlendFunc blend)
-{
-  if (r == 0)
+  ScanlineEffect effect = {0, COLOR_CLEAR, 0xFF};
+
+  if (scanlineOffsets != NULL)
+    effect.offset = scanlineOffsets[(y + scanlinePhase) % scanlineLength];
+
+  if (scanlineFunc != NULL)
+    scanlineFunc(y, effect);
+
+  // Shift the row, wrapping pixels pushed off one side around to the other
+  int shift = effect.offset % WIDTH;
+
+  if (shift < 0)
+    shift += WIDTH;
+
+  if (shift != 0)
   {
-    drawPixel(x0, y0, color, blend);
-    return;
+    memcpy(shiftedRow + shift, src, (WIDTH - shift) * sizeof(Color));
+    memcpy(shiftedRow, src + WIDTH - shift, shift * sizeof(Color));
+    src = shiftedRow;
   }
 
-  drawPixel(x0, y0+r, color, blend);
-  drawPixel(x0, y0-r, color, blend);
-  drawPixel(x0+r, y0, color, blend);
-  drawPixel(x0-r, y0, color, blend);
+  if (effect.tint.a() == 0 && effect.brightness == 0xFF)
+    return screen;
 
-  drawCircleHelper(x0, y0, r, 0xF, color, blend);
+  buildChannelTable(scanlineTable, effect.tint, effect.brightness);
+  return scanlineTable;
 }
 
-void drawCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t corners, Color color, BlendFunc blend)
+void DotMGBase::setScanlineCallback(ScanlineFunc func)
 {
-  int16_t f = -r;
-  int16_t ddF_x = 1;
-  int16_t ddF_y = -2 * r;
-  int16_t x = 0;
-  int16_t y = r;
+  scanlineFunc = func;
+}
 
-  while (x < y-1)
-  {
-    if (f >= 0)
-    {
-      y--;
-      ddF_y += 2;
-      f += ddF_y;
-    }
+void DotMGBase::setScanlineOffsets(const int8_t offsets[], uint16_t length, uint16_t phase)
+{
+  scanlineOffsets = (length > 0) ? offsets : NULL;
+  scanlineLength = length;
+  scanlinePhase = phase;
+}
 
-    x++;
-    ddF_x += 2;
-    f += ddF_x;
+/* Screen effects */
 
-    if (corners & 0x4) // lower right
-    {
-      DotMGBase::drawPixel(x0 + x, y0 + y, color, blend);
+void buildScreenTable()
+{
+  uint8_t tint[3] = {screenTintColor.r(), screenTintColor.g(), screenTintColor.b()};
+  uint8_t fade[3] = {screenFadeColor.r(), screenFadeColor.g(), screenFadeColor.b()};
+  bool invert = screenFilter & SCREEN_INVERT;
 
-      if (x != y)
-        DotMGBase::drawPixel(x0 + y, y0 + x, color, blend);
-    }
+  screenTableActive = invert || screenFadeAmount != 0 || (screenTintColor.value | 0xF) != COLOR_WHITE;
 
-    if (corners & 0x2) // upper right
+  for (uint8_t ch = 0; ch < 3; ch++)
+  {
+    for (uint8_t v = 0; v < 16; v++)
     {
-      DotMGBase::drawPixel(x0 + x, y0 - y, color, blend);
-
-      if (x != y)
-        DotMGBase::drawPixel(x0 + y, y0 - x, color, blend);
+      uint16_t c = invert ? 0xF - v : v;
+      c = (c*tint[ch] + 7) / 0xF;
+      c = (c*(0xFF - screenFadeAmount) + fade[ch]*screenFadeAmount + 0x7F) / 0xFF;
+      screenTable[ch*16 + v] = c << (8 - 4*ch);
     }
+  }
+}
 
-    if (corners & 0x8) // lower left
-    {
-      DotMGBase::drawPixel(x0 - y, y0 + x, color, blend);
+void DotMGBase::setScreenFade(uint8_t amount, Color color)
+{
+  screenFadeAmount = amount;
+  screenFadeColor = color;
+  buildScreenTable();
+}
 
-      if (x != y)
-        DotMGBase::drawPixel(x0 - x, y0 + y, color, blend);
-    }
+uint8_t DotMGBase::screenFade()
+{
+  return screenFadeAmount;
+}
 
-    if (corners & 0x1) // upper left
-    {
-      DotMGBase::drawPixel(x0 - y, y0 - x, color, blend);
+void DotMGBase::setScreenTint(Color color)
+{
+  screenTintColor = color;
+  buildScreenTable();
+}
 
-      if (x != y)
-        DotMGBase::drawPixel(x0 - x, y0 - y, color, blend);
-    }
-  }
+void DotMGBase::setScreenFilter(uint8_t filter)
+{
+  screenFilter = filter;
+  buildScreenTable();
 }
 
-void DotMGBase::fillCircle(int16_t x0, int16_t y0, uint16_t r, Color color, BlendFunc blend)
+/* Layers */
+
+void compositeSpan(Color *dst, const Color *src, int count, const uint8_t *alpha)
 {
-  if (r == 0)
+  if (alpha == NULL)
   {
-    drawPixel(x0, y0, color, blend);
+    blitSpan(dst, 1, src, count, BLEND_ALPHA);
     return;
   }
 
-  drawFastVLine(x0, y0-r, 2*r+1, color, blend);
-
-  if (r == 1)
+  for (; count > 0; count--, src++, dst++)
   {
-    drawPixel(x0-1, y0, color, blend);
-    drawPixel(x0+1, y0, color, blend);
-    return;
-  }
+    uint8_t a = alpha[src->a()];
 
-  fillCircleHelper(x0, y0, r, 3, 0, color, blend);
+    if (a == 0)
+      continue;
+
+    Color px = (src->value & 0xFFF0) | a;
+    *dst = (a == 0xF) ? px : BLEND_ALPHA(px, *dst);
+  }
 }
 
-void fillCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t sides, int16_t delta, Color color, BlendFunc blend)
+void compositeLayer(Color *row, const Layer &layer, int y)
 {
-  int16_t f = -r;
-  int16_t ddF_x = 1;
-  int16_t ddF_y = -2 * r;
-  int16_t x = 0;
-  int16_t y = r;
+  // Scale the layer's alpha values by its opacity once per row
+  uint8_t alpha[16];
+  const uint8_t *alphaTable = NULL;
 
-  while (x <= y)
+  if (layer.opacity < 0xFF)
   {
-    uint16_t lastX = x;
-    uint16_t lastY = y;
-
-    if (f >= 0)
-    {
-      y--;
-      ddF_y += 2;
-      f += ddF_y;
-    }
+    for (uint8_t a = 0; a < 16; a++)
+      alpha[a] = (a*layer.opacity + 0x7F) / 0xFF;
 
-    x++;
-    ddF_x += 2;
-    f += ddF_x;
+    alphaTable = alpha;
+  }
 
-    if (sides & 0x1) // right side
-    {
-      if (lastX != 0)
-        DotMGBase::drawFastVLine(x0+lastX, y0-lastY, 2*lastY+1+delta, color, blend);
+  // Layers repeat in both directions, so a row is made of at most a few
+  // straight runs of the layer
+  const Surface &surface = layer.surface;
+  int ly = (y + layer.scrollY) % surface.height;
+  int lx = (layer.scrollX) % surface.width;
 
-      if (lastX != lastY && y != lastY)
-        DotMGBase::drawFastVLine(x0+lastY, y0-lastX, 2*lastX+1+delta, color, blend);
-    }
+  if (ly < 0)
+    ly += surface.height;
+  if (lx < 0)
+    lx += surface.width;
 
-    if (sides & 0x2) // left side
-    {
-      if (lastX != 0)
-        DotMGBase::drawFastVLine(x0-lastX, y0-lastY, 2*lastY+1+delta, color, blend);
+  const Color *src = surface.pixels + ly*surface.stride;
 
-      if (lastX != lastY && y != lastY)
-        DotMGBase::drawFastVLine(x0-lastY, y0-lastX, 2*lastX+1+delta, color, blend);
-    }
+  for (int x = 0; x < WIDTH;)
+  {
+    int count = min(WIDTH - x, surface.width - lx);
+    compositeSpan(row + x, src + lx, count, alphaTable);
+    x += count;
+    lx = 0;
   }
 }
 
-void DotMGBase::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, Color color, BlendFunc blend)
+void compositeRow(Color *row, int y)
 {
-  // bresenham's algorithm - thx wikpedia
-  bool steep = abs(y1 - y0) > abs(x1 - x0);
-  if (steep) {
-    swap(x0, y0);
-    swap(x1, y1);
-  }
+  for (int x = 0; x < WIDTH; x++)
+    row[x] = COLOR_BLACK;
 
-  if (x0 > x1) {
-    swap(x0, x1);
-    swap(y0, y1);
+  for (uint8_t i = 0; i < DOTMG_LAYER_COUNT; i++)
+  {
+    if (layers[i].surface.pixels != NULL && layers[i].visible && !layers[i].above)
+      compositeLayer(row, layers[i], y);
   }
 
-  int16_t dx, dy;
-  dx = x1 - x0;
-  dy = abs(y1 - y0);
-
-  int16_t err = dx / 2;
-  int8_t ystep;
+  blitSpan(row, 1, frameBuf + y*WIDTH, WIDTH, BLEND_ALPHA);
 
-  if (y0 < y1)
-  {
-    ystep = 1;
-  }
-  else
+  for (uint8_t i = 0; i < DOTMG_LAYER_COUNT; i++)
   {
-    ystep = -1;
+    if (layers[i].surface.pixels != NULL && layers[i].visible && layers[i].above)
+      compositeLayer(row, layers[i], y);
   }
+}
 
-  for (; x0 <= x1; x0++)
-  {
-    if (steep)
-    {
-      drawPixel(y0, x0, color, blend);
-    }
-    else
-    {
-      drawPixel(x0, y0, color, blend);
-    }
+void DotMGBase::setLayer(uint8_t layer, Color pixels[], uint16_t width, uint16_t height, bool above)
+{
+  setLayer(layer, Surface(pixels, width, height), above);
+}
 
-    err -= dy;
-    if (err < 0)
-    {
-      y0 += ystep;
-      err += dx;
-    }
-  }
+void DotMGBase::setLayer(uint8_t layer, const Surface &surface, bool above)
+{
+  if (layer >= DOTMG_LAYER_COUNT)
+    return;
+
+  // Stop drawing into a layer that goes away or changes
+  if (target.pixels == layers[layer].surface.pixels && target.pixels != NULL)
+    setDrawTarget(NULL);
+
+  layers[layer] = Layer{surface, 0, 0, 0xFF, true, above};
+
+  if (surface.width == 0 || surface.height == 0)
+    layers[layer].surface.pixels = NULL;
 }
 
-void DotMGBase::drawRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color color, BlendFunc blend)
+void DotMGBase::setLayerVisible(uint8_t layer, bool visible)
 {
-  drawFastHLine(x, y, w, color, blend);
-  drawFastHLine(x, y+h-1, w, color, blend);
-  drawFastVLine(x, y, h, color, blend);
-  drawFastVLine(x+w-1, y, h, color, blend);
+  if (layer < DOTMG_LAYER_COUNT)
+    layers[layer].visible = visible;
 }
 
-void DotMGBase::drawFastVLine(int16_t x, int16_t y, uint16_t h, Color color, BlendFunc blend)
+void DotMGBase::setLayerScroll(uint8_t layer, int16_t x, int16_t y)
 {
-  int end = y+h;
-  for (int a = max(0, y); a < min(end, HEIGHT); a++)
+  if (layer < DOTMG_LAYER_COUNT)
   {
-    drawPixel(x, a, color, blend);
+    layers[layer].scrollX = x;
+    layers[layer].scrollY = y;
   }
 }
 
-void DotMGBase::drawFastHLine(int16_t x, int16_t y, uint16_t w, Color color, BlendFunc blend)
+void DotMGBase::setLayerOpacity(uint8_t layer, uint8_t opacity)
 {
-  int end = x+w;
-  for (int a = max(0, x); a < min(end, WIDTH); a++)
-  {
-    drawPixel(a, y, color, blend);
-  }
+  if (layer < DOTMG_LAYER_COUNT)
+    layers[layer].opacity = opacity;
 }
 
-void DotMGBase::fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color color, BlendFunc blend)
+bool DotMGBase::setDrawLayer(int8_t layer)
 {
-  for (int16_t i=x; i<x+w; i++)
+  if (layer < 0)
   {
-    drawFastVLine(i, y, h, color, blend);
+    setDrawTarget(NULL);
+    return true;
   }
+
+  if (layer >= DOTMG_LAYER_COUNT || layers[layer].surface.pixels == NULL)
+    return false;
+
+  setDrawTarget(&layers[layer].surface);
+  return true;
 }
 
-void DotMGBase::fillScreen(Color color, BlendFunc blend)
+/* Surfaces */
+
+void DotMGBase::setDrawTarget(const Surface *surface)
 {
-  fillRect(0, 0, WIDTH, HEIGHT, color, blend);
+  target = (surface != NULL) ? *surface : Surface(frameBuf, WIDTH, HEIGHT);
+  resetView();
 }
 
-void DotMGBase::drawRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, Color color, BlendFunc blend)
+Surface DotMGBase::drawTarget()
 {
-  // smarter version
-  drawFastHLine(x+r, y, w-2*r, color, blend); // Top
-  drawFastHLine(x+r, y+h-1, w-2*r, color, blend); // Bottom
-  drawFastVLine(x, y+r, h-2*r, color, blend); // Left
-  drawFastVLine(x+w-1, y+r, h-2*r, color, blend); // Right
-  // draw four corners
-  drawCircleHelper(x+r, y+r, r, 1, color, blend);
-  drawCircleHelper(x+w-r-1, y+r, r, 2, color, blend);
-  drawCircleHelper(x+w-r-1, y+h-r-1, r, 4, color, blend);
-  drawCircleHelper(x+r, y+h-r-1, r, 8, color, blend);
+  return target;
 }
 
-void DotMGBase::fillRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, Color color, BlendFunc blend)
+void DotMGBase::drawSurface(int16_t x, int16_t y, const Surface &surface, BlendFunc blend, uint8_t flags)
 {
-  // smarter version
-  fillRect(x+r, y, w-2*r, h, color, blend);
+  blitBitmap(x + view.originX, y + view.originY, surface.pixels, surface.stride, surface.width, surface.height, blend, flags);
+}
 
-  // draw four corners
-  fillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color, blend);
-  fillCircleHelper(x+r, y+r, r, 2, h-2*r-1, color, blend);
+void DotMGBase::copySurface(int16_t x, int16_t y, const Surface &surface, uint8_t flags)
+{
+  copyBitmap(x + view.originX, y + view.originY, surface.pixels, surface.stride, surface.width, surface.height, flags);
 }
 
-void DotMGBase::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, Color color, BlendFunc blend)
+/* Views */
+
+bool saveView()
 {
-  // Reuse stage buffer to track drawn pixel locations while saving RAM
-  // (it always has enough room, since it's at least 1.5x longer than we need)
-  drawnPixels = (bool *)stage;
-  memset(drawnPixels, 0, WIDTH*HEIGHT);
-  overlapAvoid = true;
+  if (viewDepth >= DOTMG_VIEW_STACK_SIZE)
+    return false;
 
-  drawLine(x0, y0, x1, y1, color, blend);
-  drawLine(x1, y1, x2, y2, color, blend);
-  drawLine(x2, y2, x0, y0, color, blend);
+  viewStack[viewDepth++] = view;
+  return true;
+}
 
-  overlapAvoid = false;
+void intersectClip(int x0, int y0, int x1, int y1)
+{
+  view.clipX0 = max(view.clipX0, x0);
+  view.clipY0 = max(view.clipY0, y0);
+  view.clipX1 = max(view.clipX0, min(view.clipX1, x1));
+  view.clipY1 = max(view.clipY0, min(view.clipY1, y1));
 }
 
-void DotMGBase::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, Color color, BlendFunc blend)
+bool clipToView(int &x0, int &y0, int &x1, int &y1)
 {
-  int16_t a, b, y, last;
-  // Sort coordinates by Y order (y2 >= y1 >= y0)
-  if (y0 > y1)
+  if (x0 < view.clipX0)
+    x0 = view.clipX0;
+  if (y0 < view.clipY0)
+    y0 = view.clipY0;
+  if (x1 > view.clipX1)
+    x1 = view.clipX1;
+  if (y1 > view.clipY1)
+    y1 = view.clipY1;
+
+  return x0 < x1 && y0 < y1;
+}
+
+uint8_t clipTest(int x0, int y0, int x1, int y1)
+{
+  if (x1 <= view.clipX0 || x0 >= view.clipX1 || y1 <= view.clipY0 || y0 >= view.clipY1)
+    return CLIP_OUTSIDE;
+
+  if (x0 >= view.clipX0 && x1 <= view.clipX1 && y0 >= view.clipY0 && y1 <= view.clipY1)
+    return CLIP_INSIDE;
+
+  return CLIP_PARTIAL;
+}
+
+bool DotMGBase::pushClipRect(int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+  if (!saveView())
+    return false;
+
+  int x0 = x + view.originX;
+  int y0 = y + view.originY;
+  intersectClip(x0, y0, x0 + w, y0 + h);
+  return true;
+}
+
+bool DotMGBase::pushTranslation(int16_t dx, int16_t dy)
+{
+  if (!saveView())
+    return false;
+
+  view.originX += dx;
+  view.originY += dy;
+  return true;
+}
+
+bool DotMGBase::pushViewport(int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+  if (!saveView())
+    return false;
+
+  int x0 = x + view.originX;
+  int y0 = y + view.originY;
+  intersectClip(x0, y0, x0 + w, y0 + h);
+  view.originX = x0;
+  view.originY = y0;
+  return true;
+}
+
+void DotMGBase::popView()
+{
+  if (viewDepth > 0)
+    view = viewStack[--viewDepth];
+}
+
+void DotMGBase::resetView()
+{
+  viewDepth = 0;
+  view.clipX0 = 0;
+  view.clipY0 = 0;
+  view.clipX1 = target.width;
+  view.clipY1 = target.height;
+  view.originX = 0;
+  view.originY = 0;
+}
+
+Rect DotMGBase::clipRect()
+{
+  return Rect(
+    view.clipX0 - view.originX,
+    view.clipY0 - view.originY,
+    view.clipX1 - view.clipX0,
+    view.clipY1 - view.clipY0
+  );
+}
+
+Point DotMGBase::viewOrigin()
+{
+  return Point(view.originX, view.originY);
+}
+
+bool DotMGBase::isVisible(int16_t x, int16_t y, uint16_t w, uint16_t h)
+{
+  int x0 = x + view.originX;
+  int y0 = y + view.originY;
+  return clipTest(x0, y0, x0 + w, y0 + h) != CLIP_OUTSIDE;
+}
+
+/* Drawing */
+
+void plotPixel(int x, int y, Color color, BlendFunc blend, bool clip)
+{
+  if (clip && (x < view.clipX0 || x >= view.clipX1 || y < view.clipY0 || y >= view.clipY1))
+    return;
+
+  if (overlapAvoid)
   {
-    swap(y0, y1); swap(x0, x1);
+    bool &drawn = drawnPixels[(y - overlapY0)*overlapWidth + x - overlapX0];
+
+    if (drawn)
+      return;
+
+    drawn = true;
   }
-  if (y1 > y2)
+
+  Color *dst = target.pixels + y*target.stride + x;
+  *dst = blend(color, *dst);
+}
+
+void fillSpan(Color *dst, int count, int step, Color color, BlendFunc blend)
+{
+  if (blend == BLEND_NONE || (blend == BLEND_ALPHA && color.a() == 0xF))
   {
-    swap(y2, y1); swap(x2, x1);
+    // Nothing to blend, so just store the color
+    for (; count > 0; count--, dst += step)
+      *dst = color;
   }
-  if (y0 > y1)
+  else if (blend != BLEND_ALPHA || color.a() != 0)
   {
-    swap(y0, y1); swap(x0, x1);
+    for (; count > 0; count--, dst += step)
+      *dst = blend(color, *dst);
   }
+}
 
-  if(y0 == y2)
-  { // Handle awkward all-on-same-line case as its own thing
-    a = b = x0;
-    if(x1 < a)
+void fillClippedRect(int x0, int y0, int x1, int y1, Color color, BlendFunc blend)
+{
+  if (!clipToView(x0, y0, x1, y1))
+    return;
+
+  for (Color *row = target.pixels + y0*target.stride + x0; y0 < y1; y0++, row += target.stride)
+  {
+    fillSpan(row, x1 - x0, 1, color, blend);
+  }
+}
+
+void DotMGBase::drawPixel(int16_t x, int16_t y, Color color, BlendFunc blend)
+{
+  plotPixel(x + view.originX, y + view.originY, color, blend, true);
+}
+
+Color DotMGBase::getPixel(int16_t x, int16_t y)
+{
+  x += view.originX;
+  y += view.originY;
+
+  if (x < 0 || x >= target.width || y < 0 || y >= target.height)
+    return COLOR_CLEAR;
+
+  return target.pixels[y*target.stride + x];
+}
+
+void DotMGBase::drawCircle(int16_t x0, int16_t y0, uint16_t r, Color color, BlendFunc blend)
+{
+  x0 += view.originX;
+  y0 += view.originY;
+
+  uint8_t visibility = clipTest(x0 - r, y0 - r, x0 + r + 1, y0 + r + 1);
+  if (visibility == CLIP_OUTSIDE)
+    return;
+
+  bool clip = (visibility != CLIP_INSIDE);
+
+  if (r == 0)
+  {
+    plotPixel(x0, y0, color, blend, clip);
+    return;
+  }
+
+  plotPixel(x0, y0+r, color, blend, clip);
+  plotPixel(x0, y0-r, color, blend, clip);
+  plotPixel(x0+r, y0, color, blend, clip);
+  plotPixel(x0-r, y0, color, blend, clip);
+
+  drawCircleHelper(x0, y0, r, 0xF, color, blend, clip);
+}
+
+void drawCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t corners, Color color, BlendFunc blend, bool clip)
+{
+  int16_t f = -r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  while (x < y-1)
+  {
+    if (f >= 0)
+    {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if (corners & 0x4) // lower right
     {
-      a = x1;
+      plotPixel(x0 + x, y0 + y, color, blend, clip);
+
+      if (x != y)
+        plotPixel(x0 + y, y0 + x, color, blend, clip);
     }
-    else if(x1 > b)
+
+    if (corners & 0x2) // upper right
     {
-      b = x1;
+      plotPixel(x0 + x, y0 - y, color, blend, clip);
+
+      if (x != y)
+        plotPixel(x0 + y, y0 - x, color, blend, clip);
     }
-    if(x2 < a)
+
+    if (corners & 0x8) // lower left
     {
-      a = x2;
+      plotPixel(x0 - y, y0 + x, color, blend, clip);
+
+      if (x != y)
+        plotPixel(x0 - x, y0 + y, color, blend, clip);
     }
-    else if(x2 > b)
+
+    if (corners & 0x1) // upper left
     {
-      b = x2;
+      plotPixel(x0 - y, y0 - x, color, blend, clip);
+
+      if (x != y)
+        plotPixel(x0 - x, y0 - y, color, blend, clip);
     }
-    drawFastHLine(a, y0, b-a+1, color, blend);
-    return;
   }
+}
 
-  int16_t dx01 = x1 - x0,
-      dy01 = y1 - y0,
-      dx02 = x2 - x0,
-      dy02 = y2 - y0,
-      dx12 = x2 - x1,
-      dy12 = y2 - y1,
-      sa = 0,
-      sb = 0;
+void DotMGBase::fillCircle(int16_t x0, int16_t y0, uint16_t r, Color color, BlendFunc blend)
+{
+  if (!isVisible(x0 - r, y0 - r, 2*r + 1, 2*r + 1))
+    return;
 
-  // For upper part of triangle, find scanline crossings for segments
-  // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
-  // is included here (and second loop will be skipped, avoiding a /0
-  // error there), otherwise scanline y1 is skipped here and handled
-  // in the second loop...which also avoids a /0 error here if y0=y1
-  // (flat-topped triangle).
-  if (y1 == y2)
+  if (r == 0)
   {
-    last = y1;   // Include y1 scanline
+    drawPixel(x0, y0, color, blend);
+    return;
   }
-  else
+
+  drawFastVLine(x0, y0-r, 2*r+1, color, blend);
+
+  if (r == 1)
   {
-    last = y1-1; // Skip it
+    drawPixel(x0-1, y0, color, blend);
+    drawPixel(x0+1, y0, color, blend);
+    return;
   }
 
+  fillCircleHelper(x0, y0, r, 3, 0, color, blend);
+}
 
-  for(y = y0; y <= last; y++)
+void fillCircleHelper(int16_t x0, int16_t y0, uint16_t r, uint8_t sides, int16_t delta, Color color, BlendFunc blend)
+{
+  int16_t f = -r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  while (x <= y)
   {
-    a   = x0 + sa / dy01;
-    b   = x0 + sb / dy02;
-    sa += dx01;
-    sb += dx02;
+    uint16_t lastX = x;
+    uint16_t lastY = y;
 
-    if(a > b)
+    if (f >= 0)
     {
-      swap(a,b);
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
     }
 
-    drawFastHLine(a, y, b-a+1, color, blend);
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if (sides & 0x1) // right side
+    {
+      if (lastX != 0)
+        DotMGBase::drawFastVLine(x0+lastX, y0-lastY, 2*lastY+1+delta, color, blend);
+
+      if (lastX != lastY && y != lastY)
+        DotMGBase::drawFastVLine(x0+lastY, y0-lastX, 2*lastX+1+delta, color, blend);
+    }
+
+    if (sides & 0x2) // left side
+    {
+      if (lastX != 0)
+        DotMGBase::drawFastVLine(x0-lastX, y0-lastY, 2*lastY+1+delta, color, blend);
+
+      if (lastX != lastY && y != lastY)
+        DotMGBase::drawFastVLine(x0-lastY, y0-lastX, 2*lastX+1+delta, color, blend);
+    }
   }
+}
 
-  // For lower part of triangle, find scanline crossings for segments
-  // 0-2 and 1-2.  This loop is skipped if y1=y2.
-  sa = dx12 * (y - y1);
-  sb = dx02 * (y - y0);
+void DotMGBase::drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, Color color, BlendFunc blend)
+{
+  x0 += view.originX;
+  y0 += view.originY;
+  x1 += view.originX;
+  y1 += view.originY;
 
-  for(; y <= y2; y++)
+  uint8_t visibility = clipTest(min(x0, x1), min(y0, y1), max(x0, x1) + 1, max(y0, y1) + 1);
+  if (visibility == CLIP_OUTSIDE)
+    return;
+
+  bool clip = (visibility != CLIP_INSIDE);
+
+  // bresenham's algorithm - thx wikpedia
+  bool steep = abs(y1 - y0) > abs(x1 - x0);
+  if (steep) {
+    swap(x0, y0);
+    swap(x1, y1);
+  }
+
+  if (x0 > x1) {
+    swap(x0, x1);
+    swap(y0, y1);
+  }
+
+  int16_t dx, dy;
+  dx = x1 - x0;
+  dy = abs(y1 - y0);
+
+  int16_t err = dx / 2;
+  int8_t ystep;
+
+  if (y0 < y1)
+  {
+    ystep = 1;
+  }
+  else
+  {
+    ystep = -1;
+  }
+
+  if (clip)
+  {
+    // Find the steps that land inside the clip rectangle and start at the
+    // first of them, so a long line crossing a small clip rectangle costs
+    // no more than the part that's drawn
+    int clipX0 = steep ? view.clipY0 : view.clipX0;
+    int clipY0 = steep ? view.clipX0 : view.clipY0;
+    int clipX1 = steep ? view.clipY1 : view.clipX1;
+    int clipY1 = steep ? view.clipX1 : view.clipY1;
+
+    // Steps along X, and moves along Y, that stay inside
+    int first = max(clipX0 - x0, 0);
+    int last = min(clipX1 - 1, (int)x1) - x0;
+    int movesMin = ystep > 0 ? clipY0 - y0 : y0 - (clipY1 - 1);
+    int movesMax = ystep > 0 ? clipY1 - 1 - y0 : y0 - clipY0;
+
+    first = max(first, lineStepsBefore(movesMin, dx, dy, err));
+    last = min(last, lineStepsBefore(movesMax + 1, dx, dy, err) - 1);
+
+    if (first > last)
+      return;
+
+    int moves = lineMoves(first, dx, dy, err);
+    x0 += first;
+    x1 = x0 + last - first;
+    y0 += moves * ystep;
+    err += moves*dx - first*dy;
+  }
+
+  for (; x0 <= x1; x0++)
+  {
+    if (steep)
+    {
+      plotPixel(y0, x0, color, blend, false);
+    }
+    else
+    {
+      plotPixel(x0, y0, color, blend, false);
+    }
+
+    err -= dy;
+    if (err < 0)
+    {
+      y0 += ystep;
+      err += dx;
+    }
+  }
+}
+
+int lineMoves(int steps, int dx, int dy, int err)
+{
+  // Each step takes dy from the error, and each move along Y adds dx back to
+  // keep it from going negative
+  int deficit = steps*dy - err;
+  return deficit > 0 ? (deficit + dx - 1) / dx : 0;
+}
+
+int lineStepsBefore(int moves, int dx, int dy, int err)
+{
+  // The first step by which Y has moved this many times, or past the end
+  if (moves <= 0)
+    return 0;
+
+  if (moves > dy)
+    return dx + 1;
+
+  return ((moves - 1)*dx + err) / dy + 1;
+}
+
+void DotMGBase::drawRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color color, BlendFunc blend)
+{
+  drawFastHLine(x, y, w, color, blend);
+  drawFastHLine(x, y+h-1, w, color, blend);
+  drawFastVLine(x, y, h, color, blend);
+  drawFastVLine(x+w-1, y, h, color, blend);
+}
+
+void DotMGBase::drawFastVLine(int16_t x, int16_t y, uint16_t h, Color color, BlendFunc blend)
+{
+  int x0 = x + view.originX;
+  int y0 = y + view.originY;
+  int x1 = x0 + 1;
+  int y1 = y0 + h;
+
+  if (!clipToView(x0, y0, x1, y1))
+    return;
+
+  fillSpan(target.pixels + y0*target.stride + x0, y1 - y0, target.stride, color, blend);
+}
+
+void DotMGBase::drawFastHLine(int16_t x, int16_t y, uint16_t w, Color color, BlendFunc blend)
+{
+  int x0 = x + view.originX;
+  int y0 = y + view.originY;
+  int x1 = x0 + w;
+  int y1 = y0 + 1;
+
+  if (!clipToView(x0, y0, x1, y1))
+    return;
+
+  fillSpan(target.pixels + y0*target.stride + x0, x1 - x0, 1, color, blend);
+}
+
+void DotMGBase::fillRect(int16_t x, int16_t y, uint16_t w, uint16_t h, Color color, BlendFunc blend)
+{
+  int x0 = x + view.originX;
+  int y0 = y + view.originY;
+  fillClippedRect(x0, y0, x0 + w, y0 + h, color, blend);
+}
+
+void DotMGBase::fillScreen(Color color, BlendFunc blend)
+{
+  fillClippedRect(view.clipX0, view.clipY0, view.clipX1, view.clipY1, color, blend);
+}
+
+void DotMGBase::drawRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, Color color, BlendFunc blend)
+{
+  int16_t sx = x + view.originX;
+  int16_t sy = y + view.originY;
+
+  uint8_t visibility = clipTest(sx, sy, sx + w, sy + h);
+  if (visibility == CLIP_OUTSIDE)
+    return;
+
+  bool clip = (visibility != CLIP_INSIDE);
+
+  // smarter version
+  drawFastHLine(x+r, y, w-2*r, color, blend); // Top
+  drawFastHLine(x+r, y+h-1, w-2*r, color, blend); // Bottom
+  drawFastVLine(x, y+r, h-2*r, color, blend); // Left
+  drawFastVLine(x+w-1, y+r, h-2*r, color, blend); // Right
+  // draw four corners
+  drawCircleHelper(sx+r, sy+r, r, 1, color, blend, clip);
+  drawCircleHelper(sx+w-r-1, sy+r, r, 2, color, blend, clip);
+  drawCircleHelper(sx+w-r-1, sy+h-r-1, r, 4, color, blend, clip);
+  drawCircleHelper(sx+r, sy+h-r-1, r, 8, color, blend, clip);
+}
+
+void DotMGBase::fillRoundRect(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t r, Color color, BlendFunc blend)
+{
+  if (!isVisible(x, y, w, h))
+    return;
+
+  // smarter version
+  fillRect(x+r, y, w-2*r, h, color, blend);
+
+  // draw four corners
+  fillCircleHelper(x+w-r-1, y+r, r, 1, h-2*r-1, color, blend);
+  fillCircleHelper(x+r, y+r, r, 2, h-2*r-1, color, blend);
+}
+
+void DotMGBase::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, Color color, BlendFunc blend)
+{
+  int16_t minX = min(x0, min(x1, x2));
+  int16_t minY = min(y0, min(y1, y2));
+  int16_t maxX = max(x0, max(x1, x2));
+  int16_t maxY = max(y0, max(y1, y2));
+
+  int bx0 = minX + view.originX;
+  int by0 = minY + view.originY;
+  int bx1 = maxX + view.originX + 1;
+  int by1 = maxY + view.originY + 1;
+
+  if (!clipToView(bx0, by0, bx1, by1))
+    return;
+
+  // Reuse stage buffer to track drawn pixel locations within the visible
+  // bounding box while saving RAM (it always has room for the whole screen,
+  // since it's at least 1.5x longer than that). Pixels drawn twice are only
+  // noticeable with blending, so huge boxes on large layers just skip this.
+  overlapAvoid = ((bx1 - bx0)*(by1 - by0) <= WIDTH*HEIGHT);
+
+  if (overlapAvoid)
+  {
+    drawnPixels = (bool *)stage;
+    overlapX0 = bx0;
+    overlapY0 = by0;
+    overlapWidth = bx1 - bx0;
+    memset(drawnPixels, 0, (bx1 - bx0)*(by1 - by0));
+  }
+
+  drawLine(x0, y0, x1, y1, color, blend);
+  drawLine(x1, y1, x2, y2, color, blend);
+  drawLine(x2, y2, x0, y0, color, blend);
+
+  overlapAvoid = false;
+}
+
+void DotMGBase::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2, Color color, BlendFunc blend)
+{
+  int16_t a, b, y, last;
+  // Sort coordinates by Y order (y2 >= y1 >= y0)
+  if (y0 > y1)
+  {
+    swap(y0, y1); swap(x0, x1);
+  }
+  if (y1 > y2)
+  {
+    swap(y2, y1); swap(x2, x1);
+  }
+  if (y0 > y1)
+  {
+    swap(y0, y1); swap(x0, x1);
+  }
+
+  int16_t minX = min(x0, min(x1, x2));
+  int16_t maxX = max(x0, max(x1, x2));
+
+  if (!isVisible(minX, y0, maxX - minX + 1, y2 - y0 + 1))
+    return;
+
+  if(y0 == y2)
+  { // Handle awkward all-on-same-line case as its own thing
+    drawFastHLine(minX, y0, maxX-minX+1, color, blend);
+    return;
+  }
+
+  int16_t dx01 = x1 - x0,
+      dy01 = y1 - y0,
+      dx02 = x2 - x0,
+      dy02 = y2 - y0,
+      dx12 = x2 - x1,
+      dy12 = y2 - y1,
+      sa = 0,
+      sb = 0;
+
+  // For upper part of triangle, find scanline crossings for segments
+  // 0-1 and 0-2.  If y1=y2 (flat-bottomed triangle), the scanline y1
+  // is included here (and second loop will be skipped, avoiding a /0
+  // error there), otherwise scanline y1 is skipped here and handled
+  // in the second loop...which also avoids a /0 error here if y0=y1
+  // (flat-topped triangle).
+  if (y1 == y2)
+  {
+    last = y1;   // Include y1 scanline
+  }
+  else
+  {
+    last = y1-1; // Skip it
+  }
+
+
+  for(y = y0; y <= last; y++)
+  {
+    a   = x0 + sa / dy01;
+    b   = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+
+    if(a > b)
+    {
+      swap(a,b);
+    }
+
+    drawFastHLine(a, y, b-a+1, color, blend);
+  }
+
+  // For lower part of triangle, find scanline crossings for segments
+  // 0-2 and 1-2.  This loop is skipped if y1=y2.
+  sa = dx12 * (y - y1);
+  sb = dx02 * (y - y0);
+
+  for(; y <= y2; y++)
   {
     a   = x1 + sa / dy12;
     b   = x0 + sb / dy02;
     sa += dx12;
     sb += dx02;
 
-    if(a > b)
+    if(a > b)
+    {
+      swap(a,b);
+    }
+
+    drawFastHLine(a, y, b-a+1, color, blend);
+  }
+}
+
+void orientPixel(int &x, int &y, int w, int h, uint8_t flags)
+{
+  if (flags & BITMAP_ROTATE_90)
+  {
+    int rotatedX = h - 1 - y;
+    y = x;
+    x = rotatedX;
+    swap(w, h);
+  }
+
+  if (flags & BITMAP_FLIP_X)
+    x = w - 1 - x;
+
+  if (flags & BITMAP_FLIP_Y)
+    y = h - 1 - y;
+}
+
+void orientRect(int &x, int &y, int &rw, int &rh, int w, int h, uint8_t flags)
+{
+  if (flags & BITMAP_ROTATE_90)
+  {
+    int rotatedX = h - (y + rh);
+    y = x;
+    x = rotatedX;
+    swap(rw, rh);
+    swap(w, h);
+  }
+
+  if (flags & BITMAP_FLIP_X)
+    x = w - (x + rw);
+
+  if (flags & BITMAP_FLIP_Y)
+    y = h - (y + rh);
+}
+
+void unorientRect(int &x, int &y, int &rw, int &rh, int w, int h, uint8_t flags)
+{
+  bool rotate = flags & BITMAP_ROTATE_90;
+
+  if (flags & BITMAP_FLIP_X)
+    x = (rotate ? h : w) - (x + rw);
+
+  if (flags & BITMAP_FLIP_Y)
+    y = (rotate ? w : h) - (y + rh);
+
+  if (rotate)
+  {
+    int sourceY = h - (x + rw);
+    x = y;
+    y = sourceY;
+    swap(rw, rh);
+  }
+}
+
+bool orientBlit(int bx, int by, int w, int h, uint8_t flags, Blit &blit)
+{
+  int x0 = bx, y0 = by, x1, y1;
+
+  if (flags & BITMAP_ROTATE_90)
+  {
+    x1 = bx + h;
+    y1 = by + w;
+  }
+  else
+  {
+    x1 = bx + w;
+    y1 = by + h;
+  }
+
+  if (!clipToView(x0, y0, x1, y1))
+    return false;
+
+  // Find the visible part of the source
+  blit.x = x0 - bx;
+  blit.y = y0 - by;
+  blit.width = x1 - x0;
+  blit.height = y1 - y0;
+  unorientRect(blit.x, blit.y, blit.width, blit.height, w, h, flags);
+
+  // Find where its first pixel lands, and how far apart its neighbors land
+  int dx = blit.x, dy = blit.y;
+  int colX = blit.x + 1, colY = blit.y;
+  int rowX = blit.x, rowY = blit.y + 1;
+  orientPixel(dx, dy, w, h, flags);
+  orientPixel(colX, colY, w, h, flags);
+  orientPixel(rowX, rowY, w, h, flags);
+
+  blit.dst = target.pixels + (by + dy)*target.stride + bx + dx;
+  blit.colStep = (colX - dx) + (colY - dy)*target.stride;
+  blit.rowStep = (rowX - dx) + (rowY - dy)*target.stride;
+  return true;
+}
+
+void blitSpan(Color *dst, int step, const Color *src, int count, BlendFunc blend)
+{
+  if (blend != BLEND_ALPHA && blend != BLEND_NONE)
+  {
+    for (; count > 0; count--, src++, dst += step)
+    {
+      Color px = *src;
+
+      if (px.a())
+        *dst = blend(px, *dst);
+    }
+    return;
+  }
+
+  // With these blending functions an opaque pixel simply replaces the pixel
+  // beneath it, so runs of opaque pixels are copied and transparent runs skipped
+  while (count > 0)
+  {
+    int run = 0;
+
+    while (run < count && src[run].a() == 0)
+      run++;
+
+    src += run;
+    dst += run * step;
+    count -= run;
+
+    for (run = 0; run < count && src[run].a() == 0xF; run++);
+
+    if (run > 0)
+    {
+      copySpan(dst, step, src, run);
+      src += run;
+      dst += run * step;
+      count -= run;
+    }
+
+    for (; count > 0; count--, src++, dst += step)
+    {
+      uint8_t a = src->a();
+
+      if (a == 0 || a == 0xF)
+        break;
+
+      *dst = blend(*src, *dst);
+    }
+  }
+}
+
+void copySpan(Color *dst, int step, const Color *src, int count)
+{
+  if (step == 1)
+  {
+    memcpy(dst, src, count * sizeof(Color));
+    return;
+  }
+
+  for (; count > 0; count--, src++, dst += step)
+    *dst = *src;
+}
+
+void blitBitmap(int bx, int by, const Color *bitmap, int stride, int w, int h, BlendFunc blend, uint8_t flags)
+{
+  Blit blit;
+
+  // Clip once, then only visit the visible part of the bitmap
+  if (!orientBlit(bx, by, w, h, flags, blit))
+    return;
+
+  const Color *src = bitmap + blit.y*stride + blit.x;
+
+  for (int row = 0; row < blit.height; row++, src += stride, blit.dst += blit.rowStep)
+  {
+    blitSpan(blit.dst, blit.colStep, src, blit.width, blend);
+  }
+}
+
+void copyBitmap(int bx, int by, const Color *bitmap, int stride, int w, int h, uint8_t flags)
+{
+  Blit blit;
+
+  if (!orientBlit(bx, by, w, h, flags, blit))
+    return;
+
+  const Color *src = bitmap + blit.y*stride + blit.x;
+
+  for (int row = 0; row < blit.height; row++, src += stride, blit.dst += blit.rowStep)
+  {
+    copySpan(blit.dst, blit.colStep, src, blit.width);
+  }
+}
+
+void DotMGBase::drawBitmap(int16_t x, int16_t y, const Color bitmap[], uint16_t w, uint16_t h, BlendFunc blend, uint8_t flags)
+{
+  blitBitmap(x + view.originX, y + view.originY, bitmap, w, w, h, blend, flags);
+}
+
+void DotMGBase::drawFrame(const SpriteAtlas &atlas, uint16_t index, int16_t x, int16_t y, BlendFunc blend, uint8_t flags)
+{
+  const AtlasFrame &frame = atlas.frames[index];
+  Rect bounds = frameBounds(atlas, index, x, y, flags);
+
+  blitBitmap(
+    bounds.x + view.originX,
+    bounds.y + view.originY,
+    atlas.image + frame.y*atlas.width + frame.x,
+    atlas.width,
+    frame.width,
+    frame.height,
+    blend,
+    flags
+  );
+}
+
+Rect DotMGBase::frameBounds(const SpriteAtlas &atlas, uint16_t index, int16_t x, int16_t y, uint8_t flags)
+{
+  const AtlasFrame &frame = atlas.frames[index];
+
+  // Orient the trimmed pixels and the pivot (a zero-sized rectangle) within
+  // the untrimmed frame
+  int trimX = frame.offsetX, trimY = frame.offsetY, trimW = frame.width, trimH = frame.height;
+  int pivotX = frame.pivotX, pivotY = frame.pivotY, pivotW = 0, pivotH = 0;
+  orientRect(trimX, trimY, trimW, trimH, frame.frameWidth, frame.frameHeight, flags);
+  orientRect(pivotX, pivotY, pivotW, pivotH, frame.frameWidth, frame.frameHeight, flags);
+
+  return Rect(x - pivotX + trimX, y - pivotY + trimY, trimW, trimH);
+}
+
+void DotMGBase::drawSprite(int16_t x, int16_t y, const uint16_t sprite[], BlendFunc blend, uint8_t flags)
+{
+  Blit blit;
+
+  if (!orientBlit(x + view.originX, y + view.originY, sprite[0], sprite[1], flags, blit))
+    return;
+
+  const uint16_t *rowOffsets = sprite + 2;
+  bool copyOpaque = (blend == BLEND_ALPHA || blend == BLEND_NONE);
+  int x1 = blit.x + blit.width;
+
+  for (int row = blit.y; row < blit.y + blit.height; row++, blit.dst += blit.rowStep)
+  {
+    const uint16_t *run = sprite + rowOffsets[row];
+    const uint16_t *rowEnd = sprite + rowOffsets[row + 1];
+
+    for (int px = 0; run < rowEnd && px < x1;)
+    {
+      uint16_t type = *run & SPRITE_RUN_TYPE_MASK;
+      int length = *run & SPRITE_RUN_LENGTH_MASK;
+      const Color *src = (const Color *)++run;
+
+      if (type == SPRITE_RUN_SKIP)
+      {
+        px += length;
+        continue;
+      }
+
+      run += length;
+
+      // Clip the run to the visible columns
+      int start = max(px, blit.x);
+      int end = min(px + length, x1);
+      src += start - px;
+      px += length;
+
+      if (start >= end)
+        continue;
+
+      Color *dst = blit.dst + (start - blit.x)*blit.colStep;
+
+      if (type == SPRITE_RUN_OPAQUE && copyOpaque)
+      {
+        copySpan(dst, blit.colStep, src, end - start);
+      }
+      else
+      {
+        for (; start < end; start++, src++, dst += blit.colStep)
+          *dst = blend(*src, *dst);
+      }
+    }
+  }
+}
+
+void clipAffineSpan(int64_t value, int32_t step, int32_t end, int &k0, int &k1)
+{
+  // Narrow the steps k0 <= k < k1 to those where 0 <= value + k*step < end
+  int64_t first, last;
+
+  if (step > 0)
+  {
+    int64_t n = -value;
+    first = (n >= 0) ? (n + step - 1) / step : -(-n / step);
+    n = end - value;
+    last = (n >= 0) ? (n + step - 1) / step : -(-n / step);
+  }
+  else if (step < 0)
+  {
+    int64_t s = -(int64_t)step;
+    int64_t n = value - end;
+    first = ((n >= 0) ? n / s : -((-n + s - 1) / s)) + 1;
+    n = value;
+    last = ((n >= 0) ? n / s : -((-n + s - 1) / s)) + 1;
+  }
+  else
+  {
+    if (value < 0 || value >= end)
+      k1 = k0;
+    return;
+  }
+
+  if (first > k0)
+    k0 = (first < k1) ? first : k1;
+
+  if (last < k1)
+    k1 = (last > k0) ? last : k0;
+}
+
+void affineSpan(Color *dst, int count, const Color *bitmap, uint16_t w, int32_t u, int32_t v, int32_t du, int32_t dv, BlendFunc blend)
+{
+  bool copyOpaque = (blend == BLEND_ALPHA || blend == BLEND_NONE);
+
+  for (; count > 0; count--, dst++, u += du, v += dv)
+  {
+    Color px = bitmap[(v >> 16)*w + (u >> 16)];
+    uint8_t a = px.a();
+
+    if (a == 0xF && copyOpaque)
+      *dst = px;
+    else if (a)
+      *dst = blend(px, *dst);
+  }
+}
+
+void DotMGBase::drawBitmapAffine(const Color bitmap[], uint16_t w, uint16_t h, const AffineMatrix &matrix, BlendFunc blend)
+{
+  AffineMatrix inv = matrix.inverse();
+
+  if (inv.a == 0 && inv.b == 0 && inv.c == 0 && inv.d == 0)
+    return;
+
+  // Find the screen area covered by the transformed bitmap
+  int32_t cornersX[4] = {0, (int32_t)w << 16, 0, (int32_t)w << 16};
+  int32_t cornersY[4] = {0, 0, (int32_t)h << 16, (int32_t)h << 16};
+  int32_t minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+
+  for (uint8_t i = 0; i < 4; i++)
+  {
+    int32_t px = (((int64_t)matrix.a*cornersX[i] + (int64_t)matrix.b*cornersY[i]) >> 16) + matrix.tx;
+    int32_t py = (((int64_t)matrix.c*cornersX[i] + (int64_t)matrix.d*cornersY[i]) >> 16) + matrix.ty;
+    minX = min(minX, px);
+    minY = min(minY, py);
+    maxX = max(maxX, px);
+    maxY = max(maxY, py);
+  }
+
+  int x0 = (minX >> 16) + view.originX;
+  int y0 = (minY >> 16) + view.originY;
+  int x1 = ((maxX + 0xFFFF) >> 16) + view.originX;
+  int y1 = ((maxY + 0xFFFF) >> 16) + view.originY;
+
+  if (!clipToView(x0, y0, x1, y1))
+    return;
+
+  // Source position of the center of the first pixel of the first row
+  // (it can be far outside the bitmap, so keep it in 64 bits until clipped)
+  int32_t cx = (int32_t)(x0 - view.originX) * 0x10000 + 0x8000;
+  int32_t cy = (int32_t)(y0 - view.originY) * 0x10000 + 0x8000;
+  int64_t rowU = (((int64_t)inv.a*cx + (int64_t)inv.b*cy) >> 16) + inv.tx;
+  int64_t rowV = (((int64_t)inv.c*cx + (int64_t)inv.d*cy) >> 16) + inv.ty;
+
+  for (Color *row = target.pixels + y0*target.stride + x0; y0 < y1; y0++, row += target.stride, rowU += inv.b, rowV += inv.d)
+  {
+    // Only visit the part of the row that lands inside the bitmap
+    int k0 = 0;
+    int k1 = x1 - x0;
+    clipAffineSpan(rowU, inv.a, (int32_t)w << 16, k0, k1);
+    clipAffineSpan(rowV, inv.c, (int32_t)h << 16, k0, k1);
+
+    if (k0 < k1)
+      affineSpan(row + k0, k1 - k0, bitmap, w, (int32_t)(rowU + (int64_t)k0*inv.a), (int32_t)(rowV + (int64_t)k0*inv.c), inv.a, inv.c, blend);
+  }
+}
+
+void DotMGBase::drawBitmapScanlines(const Color bitmap[], uint16_t w, uint16_t h, int16_t y, uint16_t rows, AffineScanlineFunc scanline, BlendFunc blend, bool wrap)
+{
+  int x0 = view.clipX0, x1 = view.clipX1;
+  int y0 = y + view.originY, y1 = y0 + rows;
+
+  if (!clipToView(x0, y0, x1, y1))
+    return;
+
+  bool copyOpaque = (blend == BLEND_ALPHA || blend == BLEND_NONE);
+  bool powerOfTwo = !(w & (w - 1)) && !(h & (h - 1));
+
+  for (Color *row = target.pixels + y0*target.stride + x0; y0 < y1; y0++, row += target.stride)
+  {
+    AffineScanline line;
+
+    if (!scanline(y0 - view.originY, line))
+      continue;
+
+    // Step from view X coordinate 0 to the first visible pixel, which can
+    // be far outside the bitmap before clipping
+    int start = x0 - view.originX;
+    int64_t u = line.u + (int64_t)start*line.du;
+    int64_t v = line.v + (int64_t)start*line.dv;
+
+    if (!wrap)
+    {
+      int k0 = 0;
+      int k1 = x1 - x0;
+      clipAffineSpan(u, line.du, (int32_t)w << 16, k0, k1);
+      clipAffineSpan(v, line.dv, (int32_t)h << 16, k0, k1);
+
+      if (k0 < k1)
+        affineSpan(row + k0, k1 - k0, bitmap, w, (int32_t)(u + (int64_t)k0*line.du), (int32_t)(v + (int64_t)k0*line.dv), line.du, line.dv, blend);
+
+      continue;
+    }
+
+    // Wrapping only needs the low bits, so step them in unsigned arithmetic,
+    // where running past the range is well defined
+    Color *dst = row;
+    uint32_t wrapU = (uint32_t)u;
+    uint32_t wrapV = (uint32_t)v;
+
+    for (int count = x1 - x0; count > 0; count--, dst++, wrapU += line.du, wrapV += line.dv)
+    {
+      int sx = (int32_t)wrapU >> 16;
+      int sy = (int32_t)wrapV >> 16;
+
+      if (powerOfTwo)
+      {
+        sx &= w - 1;
+        sy &= h - 1;
+      }
+      else
+      {
+        sx %= w;
+        sy %= h;
+        if (sx < 0)
+          sx += w;
+        if (sy < 0)
+          sy += h;
+      }
+
+      Color px = bitmap[sy*w + sx];
+      uint8_t a = px.a();
+
+      if (a == 0xF && copyOpaque)
+        *dst = px;
+      else if (a)
+        *dst = blend(px, *dst);
+    }
+  }
+}
+
+uint16_t DotMGBase::spriteWidth(const uint16_t sprite[])
+{
+  return sprite[0];
+}
+
+uint16_t DotMGBase::spriteHeight(const uint16_t sprite[])
+{
+  return sprite[1];
+}
+
+int floorDiv(int a, int b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+void drawTiles(const TileMap &map, int cameraX, int cameraY, BlendFunc blend, bool fillBackground)
+{
+  const Tileset &tileset = *map.tileset;
+  int tw = tileset.tileWidth;
+  int th = tileset.tileHeight;
+  int tileSize = tw * th;
+  bool copyOpaque = (blend == BLEND_ALPHA || blend == BLEND_NONE);
+
+  if (view.clipX0 >= view.clipX1 || view.clipY0 >= view.clipY1)
+    return;
+
+  // Map pixel mapX, mapY lands at screen coordinates mapX - left, mapY - top
+  int left = cameraX - view.originX;
+  int top = cameraY - view.originY;
+  int col0 = floorDiv(view.clipX0 + left, tw);
+  int col1 = floorDiv(view.clipX1 - 1 + left, tw);
+  int row0 = floorDiv(view.clipY0 + top, th);
+  int row1 = floorDiv(view.clipY1 - 1 + top, th);
+
+  for (int row = row0; row <= row1; row++)
+  {
+    int by = row*th - top;
+    bool rowInside = (row >= 0 && row < map.height);
+
+    for (int col = col0; col <= col1; col++)
+    {
+      int bx = col*tw - left;
+      uint16_t cell = TILE_NONE;
+
+      if (rowInside && col >= 0 && col < map.width)
+        cell = map.cells[row*map.width + col];
+
+      uint16_t index = DotMGBase::tileIndex(map, cell);
+      uint8_t tileFlags = TILE_EMPTY;
+
+      if (index < tileset.tileCount)
+        tileFlags = (tileset.flags != NULL) ? tileset.flags[index] : 0;
+
+      if (fillBackground && !(tileFlags & TILE_OPAQUE))
+        fillClippedRect(bx, by, bx + tw, by + th, bgColor, BLEND_NONE);
+
+      if (tileFlags & TILE_EMPTY)
+        continue;
+
+      const Color *tile = tileset.image + index*tileSize;
+      uint8_t orientation = cell >> 13;
+
+      if ((tileFlags & TILE_OPAQUE) && copyOpaque)
+        copyBitmap(bx, by, tile, tw, tw, th, orientation);
+      else
+        blitBitmap(bx, by, tile, tw, tw, th, blend, orientation);
+    }
+  }
+}
+
+void DotMGBase::drawTileMap(const TileMap &map, int16_t cameraX, int16_t cameraY, BlendFunc blend)
+{
+  drawTiles(map, cameraX, cameraY, blend, false);
+}
+
+uint16_t DotMGBase::tileIndex(const TileMap &map, uint16_t cell)
+{
+  const Tileset &tileset = *map.tileset;
+  uint16_t index = cell & TILE_INDEX_MASK;
+
+  for (uint8_t i = 0; i < tileset.animationCount; i++)
+  {
+    const TileAnimation &animation = tileset.animations[i];
+
+    if (animation.first == index)
+      return index + (currFrame / max(animation.duration, 1)) % max(animation.frames, 1);
+  }
+
+  return index;
+}
+
+/* Deferred drawing */
+
+static void renderFillRect(const DrawCommand &command)
+{
+  DotMGBase::fillRect(command.x0, command.y0, command.x1 - command.x0, command.y1 - command.y0, command.color, command.blend);
+}
+
+static void renderRect(const DrawCommand &command)
+{
+  DotMGBase::drawRect(command.x0, command.y0, command.x1 - command.x0, command.y1 - command.y0, command.color, command.blend);
+}
+
+static void renderLine(const DrawCommand &command)
+{
+  DotMGBase::drawLine(command.x0, command.y0, command.x1, command.y1, command.color, command.blend);
+}
+
+static void renderBitmap(const DrawCommand &command)
+{
+  DotMGBase::drawBitmap(command.x0, command.y0, (const Color *)command.data, command.x1 - command.x0, command.y1 - command.y0, command.blend, command.flags);
+}
+
+bool DotMGBase::queueFillRect(uint8_t layer, int16_t x, int16_t y, uint16_t w, uint16_t h, Color color, BlendFunc blend)
+{
+  DrawCommand command;
+  command.render = renderFillRect;
+  command.x0 = command.left = x;
+  command.y0 = command.top = y;
+  command.x1 = command.right = x + w;
+  command.y1 = command.bottom = y + h;
+  command.color = color;
+  command.blend = blend;
+  command.layer = layer;
+  command.opaque = (blend == BLEND_NONE || (blend == BLEND_ALPHA && color.a() == 0xF));
+  return queueCommand(command);
+}
+
+bool DotMGBase::queueRect(uint8_t layer, int16_t x, int16_t y, uint16_t w, uint16_t h, Color color, BlendFunc blend)
+{
+  DrawCommand command;
+  command.render = renderRect;
+  command.x0 = command.left = x;
+  command.y0 = command.top = y;
+  command.x1 = command.right = x + w;
+  command.y1 = command.bottom = y + h;
+  command.color = color;
+  command.blend = blend;
+  command.layer = layer;
+  command.opaque = false;
+  return queueCommand(command);
+}
+
+bool DotMGBase::queueLine(uint8_t layer, int16_t x0, int16_t y0, int16_t x1, int16_t y1, Color color, BlendFunc blend)
+{
+  DrawCommand command;
+  command.render = renderLine;
+  command.x0 = x0;
+  command.y0 = y0;
+  command.x1 = x1;
+  command.y1 = y1;
+  command.left = min(x0, x1);
+  command.top = min(y0, y1);
+  command.right = max(x0, x1) + 1;
+  command.bottom = max(y0, y1) + 1;
+  command.color = color;
+  command.blend = blend;
+  command.layer = layer;
+  command.opaque = false;
+  return queueCommand(command);
+}
+
+bool DotMGBase::queueBitmap(uint8_t layer, int16_t x, int16_t y, const Color bitmap[], uint16_t w, uint16_t h, BlendFunc blend, uint8_t flags)
+{
+  bool rotate = flags & BITMAP_ROTATE_90;
+
+  DrawCommand command;
+  command.render = renderBitmap;
+  command.data = bitmap;
+  command.x0 = command.left = x;
+  command.y0 = command.top = y;
+  command.x1 = x + w;
+  command.y1 = y + h;
+  command.right = x + (rotate ? h : w);
+  command.bottom = y + (rotate ? w : h);
+  command.blend = blend;
+  command.layer = layer;
+  command.flags = flags;
+  command.opaque = false;
+  return queueCommand(command);
+}
+
+bool DotMGBase::queueCommand(const DrawCommand &command)
+{
+  if (drawListCount >= DOTMG_DRAW_LIST_SIZE)
+    return false;
+
+  DrawCommand &queued = drawList[drawListCount];
+  queued = command;
+
+  // Convert to screen coordinates, so the view can change before flushing
+  queued.x0 += view.originX;
+  queued.y0 += view.originY;
+  queued.x1 += view.originX;
+  queued.y1 += view.originY;
+
+  int left = command.left + view.originX;
+  int top = command.top + view.originY;
+  int right = command.right + view.originX;
+  int bottom = command.bottom + view.originY;
+
+  // The draw list is always rendered into the frame buffer
+  right = min(right, WIDTH);
+  bottom = min(bottom, HEIGHT);
+
+  if (!clipToView(left, top, right, bottom))
+    return true;  // Nothing would be drawn
+
+  queued.left = left;
+  queued.top = top;
+  queued.right = right;
+  queued.bottom = bottom;
+
+  drawListCount++;
+  return true;
+}
+
+void DotMGBase::flushDrawList()
+{
+  if (drawListCount == 0)
+    return;
+
+  // Sort by layer, keeping queued order within each layer
+  for (uint16_t i = 0; i < drawListCount; i++)
+  {
+    uint8_t layer = drawList[i].layer;
+    uint16_t j = i;
+
+    for (; j > 0 && drawList[drawOrder[j-1]].layer > layer; j--)
+    {
+      drawOrder[j] = drawOrder[j-1];
+    }
+
+    drawOrder[j] = i;
+  }
+
+  // Bin each command into the tiles its bounds touch
+  memset(drawBins, 0, sizeof(drawBins));
+
+  for (uint16_t i = 0; i < drawListCount; i++)
+  {
+    const DrawCommand &command = drawList[i];
+    int tx0 = command.left / DOTMG_DRAW_TILE_SIZE;
+    int ty0 = command.top / DOTMG_DRAW_TILE_SIZE;
+    int tx1 = (command.right - 1) / DOTMG_DRAW_TILE_SIZE;
+    int ty1 = (command.bottom - 1) / DOTMG_DRAW_TILE_SIZE;
+
+    for (int ty = ty0; ty <= ty1; ty++)
+    {
+      for (int tx = tx0; tx <= tx1; tx++)
+      {
+        drawBins[ty*DRAW_TILE_COLUMNS + tx][i >> 5] |= 1UL << (i & 0x1F);
+      }
+    }
+  }
+
+  // Render one tile at a time, while its part of the frame buffer is hot
+  View savedView = view;
+  Surface savedTarget = target;
+  view.originX = 0;
+  view.originY = 0;
+  target = Surface(frameBuf, WIDTH, HEIGHT);
+
+  for (int ty = 0; ty < DRAW_TILE_ROWS; ty++)
+  {
+    int tileY0 = ty * DOTMG_DRAW_TILE_SIZE;
+    int tileY1 = min(tileY0 + DOTMG_DRAW_TILE_SIZE, HEIGHT);
+
+    for (int tx = 0; tx < DRAW_TILE_COLUMNS; tx++)
+    {
+      int tileX0 = tx * DOTMG_DRAW_TILE_SIZE;
+      int tileX1 = min(tileX0 + DOTMG_DRAW_TILE_SIZE, WIDTH);
+      const uint32_t *bin = drawBins[ty*DRAW_TILE_COLUMNS + tx];
+
+      // Nothing beneath the topmost opaque command covering the tile is visible
+      int first = drawListCount - 1;
+
+      for (; first > 0; first--)
+      {
+        uint16_t i = drawOrder[first];
+        const DrawCommand &command = drawList[i];
+
+        if ((bin[i >> 5] & (1UL << (i & 0x1F))) && command.opaque &&
+            command.left <= tileX0 && command.right >= tileX1 &&
+            command.top <= tileY0 && command.bottom >= tileY1)
+        {
+          break;
+        }
+      }
+
+      for (int k = first; k < drawListCount; k++)
+      {
+        uint16_t i = drawOrder[k];
+
+        if (!(bin[i >> 5] & (1UL << (i & 0x1F))))
+          continue;
+
+        const DrawCommand &command = drawList[i];
+        view.clipX0 = max(tileX0, command.left);
+        view.clipY0 = max(tileY0, command.top);
+        view.clipX1 = min(tileX1, command.right);
+        view.clipY1 = min(tileY1, command.bottom);
+        command.render(command);
+      }
+    }
+  }
+
+  view = savedView;
+  target = savedTarget;
+  drawListCount = 0;
+}
+
+uint16_t DotMGBase::drawListLength()
+{
+  return drawListCount;
+}
+
+int16_t DotMGBase::addSprite(const SpriteAtlas &atlas, uint16_t frame, int16_t x, int16_t y, uint8_t layer, uint8_t flags, BlendFunc blend)
+{
+  if (spriteOrderCount >= DOTMG_SPRITE_CAPACITY)
+    return -1;
+
+  // Free slots have no atlas; one must exist since the pool isn't full
+  int16_t id = 0;
+
+  while (sprites[id].atlas != NULL)
+    id++;
+
+  Sprite &sprite = sprites[id];
+  sprite.atlas = &atlas;
+  sprite.x = x;
+  sprite.y = y;
+  sprite.frame = frame;
+  sprite.layer = layer;
+  sprite.flags = flags;
+  sprite.blend = blend;
+
+  spriteOrder[spriteOrderCount++] = id;
+  return id;
+}
+
+void DotMGBase::removeSprite(int16_t id)
+{
+  if (getSprite(id) == NULL)
+    return;
+
+  sprites[id].atlas = NULL;
+
+  uint16_t i = 0;
+
+  while (spriteOrder[i] != id)
+    i++;
+
+  spriteOrderCount--;
+  memmove(spriteOrder + i, spriteOrder + i + 1, (spriteOrderCount - i) * sizeof(uint16_t));
+}
+
+void DotMGBase::clearSprites()
+{
+  for (uint16_t i = 0; i < spriteOrderCount; i++)
+    sprites[spriteOrder[i]].atlas = NULL;
+
+  spriteOrderCount = 0;
+}
+
+Sprite* DotMGBase::getSprite(int16_t id)
+{
+  if (id < 0 || id >= DOTMG_SPRITE_CAPACITY || sprites[id].atlas == NULL)
+    return NULL;
+
+  return &sprites[id];
+}
+
+uint16_t DotMGBase::spriteCount()
+{
+  return spriteOrderCount;
+}
+
+uint16_t DotMGBase::drawSprites()
+{
+  // Insertion sort by layer. The order is kept between calls and is stable,
+  // so it only does real work for sprites that changed layer.
+  for (uint16_t i = 1; i < spriteOrderCount; i++)
+  {
+    uint16_t id = spriteOrder[i];
+    uint8_t layer = sprites[id].layer;
+    uint16_t j = i;
+
+    for (; j > 0 && sprites[spriteOrder[j - 1]].layer > layer; j--)
+      spriteOrder[j] = spriteOrder[j - 1];
+
+    spriteOrder[j] = id;
+  }
+
+  uint16_t drawn = 0;
+
+  for (uint16_t i = 0; i < spriteOrderCount; i++)
+  {
+    const Sprite &sprite = sprites[spriteOrder[i]];
+
+    if (sprite.flags & SPRITE_HIDDEN)
+      continue;
+
+    uint8_t flags = sprite.flags & (BITMAP_FLIP_X | BITMAP_FLIP_Y | BITMAP_ROTATE_90);
+    const SpriteAtlas &atlas = *sprite.atlas;
+    const AtlasFrame &frame = atlas.frames[sprite.frame];
+    Rect bounds = frameBounds(atlas, sprite.frame, sprite.x, sprite.y, flags);
+
+    if (!isVisible(bounds.x, bounds.y, bounds.width, bounds.height))
+      continue;
+
+    blitBitmap(
+      bounds.x + view.originX,
+      bounds.y + view.originY,
+      atlas.image + frame.y*atlas.width + frame.x,
+      atlas.width,
+      frame.width,
+      frame.height,
+      sprite.blend,
+      flags
+    );
+    drawn++;
+  }
+
+  return drawn;
+}
+
+Color* DotMGBase::frameBuffer()
+{
+  return frameBuf;
+}
+
+
+/* Random */
+
+unsigned long DotMGBase::generateRandomSeed()
+{
+  return micros();
+}
+
+void DotMGBase::initRandomSeed()
+{
+  randomSeed(generateRandomSeed());
+}
+
+
+/* Frame management */
+
+uint16_t DotMGBase::frameCount()
+{
+  return currFrame;
+}
+
+void DotMGBase::setFrameRate(uint8_t rate)
+{
+  eachFrameMillis = 1000 / rate;
+}
+
+void DotMGBase::setFrameDuration(uint16_t duration)
+{
+  eachFrameMillis = duration;
+}
+
+bool DotMGBase::nextFrame()
+{
+  uint16_t now = (uint16_t) millis();
+  uint16_t frameDurationMs = now - thisFrameStart;
+
+  if (justRendered) {
+    lastFrameDurationMs = frameDurationMs;
+    justRendered = false;
+    return false;
+  }
+  else if (frameDurationMs < eachFrameMillis)
+  {
+    return false;
+  }
+
+  // pre-render
+  justRendered = true;
+  thisFrameStart = now;
+  currFrame++;
+
+  return true;
+}
+
+bool DotMGBase::everyXFrames(uint16_t frames)
+{
+  return currFrame % frames == 0;
+}
+
+int DotMGBase::cpuLoad()
+{
+  return lastFrameDurationMs*100 / eachFrameMillis;
+}
+
+uint8_t DotMGBase::actualFrameRate()
+{
+  return 1000 / lastFrameDurationMs;
+}
+
+uint16_t DotMGBase::actualFrameDurationMs()
+{
+  return lastFrameDurationMs;
+}
+
+
+/* Buttons */
+
+bool DotMGBase::pressed(uint8_t buttons)
+{
+  return (buttonsState() & buttons) == buttons;
+}
+
+bool DotMGBase::notPressed(uint8_t buttons)
+{
+  return (buttonsState() & buttons) == 0;
+}
+
+void DotMGBase::pollButtons()
+{
+  previousButtonState = currentButtonState;
+  currentButtonState = buttonsState();
+}
+
+bool DotMGBase::justPressed(uint8_t button)
+{
+  return (!(previousButtonState & button) && (currentButtonState & button));
+}
+
+bool DotMGBase::justReleased(uint8_t button)
+{
+  return ((previousButtonState & button) && !(currentButtonState & button));
+}
+
+void DotMGBase::waitNoButtons() {
+  do {
+    delay(50); // simple button debounce
+  } while (buttonsState());
+}
+
+
+/* Collision */
+
+bool DotMGBase::collide(Point point, Rect rect)
+{
+  return ((point.x >= rect.x) && (point.x < rect.x + rect.width) &&
+      (point.y >= rect.y) && (point.y < rect.y + rect.height));
+}
+
+bool DotMGBase::collide(Rect rect1, Rect rect2)
+{
+  return !(rect2.x                >= rect1.x + rect1.width  ||
+           rect2.x + rect2.width  <= rect1.x                ||
+           rect2.y                >= rect1.y + rect1.height ||
+           rect2.y + rect2.height <= rect1.y);
+}
+
+void swap(int16_t &a, int16_t &b)
+{
+  int16_t temp = a;
+  a = b;
+  b = temp;
+}
+
+void swap(int &a, int &b)
+{
+  int temp = a;
+  a = b;
+  b = temp;
+}
+
+
+//====================================
+//========== class DotMG ==========
+//====================================
+
+  static Color textColor = COLOR_WHITE;
+  static Color textBackground = COLOR_CLEAR;
+  static BlendFunc textBlendFunc = BLEND_ALPHA;
+  static BlendFunc textBgBlendFunc = BLEND_ALPHA;
+  static uint8_t textSize = 1;
+  static bool textWrap;
+
+  // Glyphs of `font` turned into rows of column bits (bit 0 is the left
+  // column), built the first time each glyph is drawn
+  static uint8_t glyphRows[256][8];
+  static uint32_t glyphCached[256 / 32];
+
+  // Proportional font (NULL for the built-in font), and where write() left
+  // the cursor after the last character, for kerning
+  static const Font *textFont;
+  static uint8_t lastChar;
+  static int16_t lastCursorX = -1;
+  static int16_t lastCursorY;
+
+  // How far glyphs of `reachFont` can reach left of the pen, if the pen never
+  // moves back (see fontReach())
+  static const Font *reachFont;
+  static int16_t reachLeft;
+  static bool reachBounded;
+
+  // "00" to "99", for converting numbers two digits at a time
+  static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+  static const uint16_t powersOf10[] = {1, 10, 100, 1000, 10000};
+
+static const uint8_t* glyph(uint8_t c);
+static int8_t kerning(const Font &font, uint8_t left, uint8_t right);
+static int16_t charAdvance(const Font *font, uint8_t c, uint8_t size);
+static int16_t lineHeight(const Font *font, uint8_t size);
+static bool fontReach(const Font &font, int16_t &reach);
+static void drawFontChar(const Font &font, int x, int y, uint8_t c, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend);
+static int16_t penAdvance(const Font *font, uint8_t prev, uint8_t c, uint8_t size, int16_t &x);
+static int16_t lineWidth(const char *&c, const Font *font, uint8_t size);
+static void drawTextRun(int16_t x, int16_t y, const char *text, uint16_t length, const Font *font, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend);
+static void drawText(int16_t x, int16_t y, const char *text, const Font *font, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend);
+static void drawGlyph(int x, int y, const uint8_t *bits, uint8_t width, uint8_t height, uint8_t stride, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend);
+static void charExtents(const char *text, size_t length, const Font *font, uint8_t size, int16_t *pen, int16_t *start, int16_t *left, int16_t *right);
+static Rect textBounds(const char *text, const Font *font, uint8_t size);
+static bool textCacheable(Color color, Color bg, BlendFunc textBlend, BlendFunc bgBlend);
+static bool updateTextCache(TextCache &cache, const char *text);
+static char* formatDigits(char *end, uint32_t value, uint8_t minDigits);
+static void drawDecimal(int16_t x, int16_t y, bool negative, uint32_t whole, uint32_t fraction, uint8_t decimals, uint8_t width, bool zeroPad);
+
+
+size_t DotMG::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    cursor_y += lineHeight(textFont, textSize);
+    cursor_x = 0;
+  }
+  else if (c == '\r')
+  {
+    // skip em
+  }
+  else if (textFont != NULL)
+  {
+    int16_t advance = charAdvance(textFont, c, textSize);
+
+    if (textWrap && cursor_x > 0 && cursor_x + advance > WIDTH)
+      write('\n');
+
+    // Kern against the previous character if nothing moved the cursor since
+    if (cursor_x == lastCursorX && cursor_y == lastCursorY)
+      cursor_x += kerning(*textFont, lastChar, c) * textSize;
+
+    drawFontChar(*textFont, cursor_x + view.originX, cursor_y + view.originY, c, textColor, textBackground, textSize, textBlendFunc, textBgBlendFunc);
+    cursor_x += advance;
+    lastChar = c;
+    lastCursorX = cursor_x;
+    lastCursorY = cursor_y;
+  }
+  else
+  {
+    drawChar(cursor_x, cursor_y, c, textColor, textBackground, textSize, textBlendFunc, textBgBlendFunc);
+    cursor_x += textSize * 6;
+    if (textWrap && (cursor_x > (WIDTH - textSize * 6)))
+    {
+      // calling ourselves recursively for 'newline' is
+      // 12 bytes smaller than doing the same math here
+      write('\n');
+    }
+  }
+  return 1;
+}
+
+const uint8_t* glyph(uint8_t c)
+{
+  if (!(glyphCached[c >> 5] & (1UL << (c & 0x1F))))
+  {
+    const unsigned char *columns = font + c * 5;
+
+    for (uint8_t row = 0; row < 8; row++)
+    {
+      uint8_t bits = 0;
+
+      for (uint8_t col = 0; col < 5; col++)
+        bits |= ((columns[col] >> row) & 0x1) << col;
+
+      glyphRows[c][row] = bits;
+    }
+
+    glyphCached[c >> 5] |= 1UL << (c & 0x1F);
+  }
+
+  return glyphRows[c];
+}
+
+void drawGlyph(int x, int y, const uint8_t *bits, uint8_t width, uint8_t height, uint8_t stride, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend)
+{
+  bool drawFg = color.a();
+  bool drawBg = bg.a();
+
+  // Each row is split into runs of set and clear bits, and each run is
+  // filled as one rectangle of size x size pixels per bit
+  for (uint8_t row = 0; row < height; row++, bits += stride, y += size)
+  {
+    if (y >= view.clipY1 || y + size <= view.clipY0)
+      continue;
+
+    uint8_t col = 0;
+
+    while (col < width)
+    {
+      bool on = (bits[col >> 3] >> (col & 0x7)) & 0x1;
+      uint8_t start = col;
+
+      do
+        col++;
+      while (col < width && ((bits[col >> 3] >> (col & 0x7)) & 0x1) == on);
+
+      if (on ? drawFg : drawBg)
+        fillClippedRect(x + start*size, y, x + col*size, y + size, on ? color : bg, on ? textBlend : bgBlend);
+    }
+  }
+}
+
+void DotMG::drawChar(int16_t x, int16_t y, unsigned char c, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend)
+{
+  if (!isVisible(x, y, 6 * size, 8 * size))
+  {
+    return;
+  }
+
+  // The font's sixth column is always blank, for spacing
+  drawGlyph(x + view.originX, y + view.originY, glyph(c), 6, 8, 1, color, bg, size, textBlend, bgBlend);
+}
+
+int8_t kerning(const Font &font, uint8_t left, uint8_t right)
+{
+  // Pairs are sorted by left, then right character
+  uint16_t pair = (left << 8) | right;
+  int lo = 0, hi = font.kerningCount - 1;
+
+  while (lo <= hi)
+  {
+    int mid = (lo + hi) >> 1;
+    const FontKerning &k = font.kerning[mid];
+    uint16_t midPair = (k.left << 8) | k.right;
+
+    if (midPair == pair)
+      return k.amount;
+
+    if (midPair < pair)
+      lo = mid + 1;
+    else
+      hi = mid - 1;
+  }
+
+  return 0;
+}
+
+int16_t charAdvance(const Font *font, uint8_t c, uint8_t size)
+{
+  if (font == NULL)
+    return 6 * size;
+
+  if (c < font->first || c > font->last)
+    return 0;
+
+  return font->glyphs[c - font->first].advance * size;
+}
+
+int16_t lineHeight(const Font *font, uint8_t size)
+{
+  return (font != NULL ? font->lineHeight : 8) * size;
+}
+
+bool fontReach(const Font &font, int16_t &reach)
+{
+  // Glyphs start at most this far left of the pen, after kerning. That only
+  // bounds the text if the pen never moves back, so negative kerning must be
+  // made up for by every advance, and pairs can't involve characters that
+  // aren't in the font, which have no advance.
+  if (&font != reachFont)
+  {
+    int16_t minKerning = 0, minAdvance = 0xFF, minOffset = 0;
+    bool pairsInFont = true;
+
+    for (uint16_t i = 0; i < font.kerningCount; i++)
+    {
+      const FontKerning &k = font.kerning[i];
+      minKerning = min(minKerning, k.amount);
+      pairsInFont = pairsInFont && k.left >= font.first && k.left <= font.last &&
+                    k.right >= font.first && k.right <= font.last;
+    }
+
+    for (int c = font.first; c <= font.last; c++)
     {
-      swap(a,b);
+      const FontGlyph &g = font.glyphs[c - font.first];
+      minAdvance = min(minAdvance, g.advance);
+      minOffset = min(minOffset, g.offsetX);
     }
 
-    drawFastHLine(a, y, b-a+1, color, blend);
+    reachFont = &font;
+    reachLeft = minKerning + minOffset;
+    reachBounded = minKerning == 0 || (pairsInFont && minAdvance + minKerning >= 0);
   }
+
+  reach = reachLeft;
+  return reachBounded;
 }
 
-void DotMGBase::drawBitmap(int16_t x, int16_t y, const Color bitmap[], uint16_t w, uint16_t h, BlendFunc blend)
+void drawFontChar(const Font &font, int x, int y, uint8_t c, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend)
 {
-  if (x+w < 0 || x >= WIDTH || y+h < 0 || y >= HEIGHT)
+  if (c < font.first || c > font.last)
+    return;
+
+  const FontGlyph &g = font.glyphs[c - font.first];
+
+  // The background covers the whole character cell, not just the glyph
+  if (bg.a())
+    fillClippedRect(x, y, x + g.advance*size, y + font.lineHeight*size, bg, bgBlend);
+
+  int gx = x + g.offsetX*size;
+  int gy = y + (font.baseline + g.offsetY)*size;
+
+  if (clipTest(gx, gy, gx + g.width*size, gy + g.height*size) == CLIP_OUTSIDE)
     return;
 
-  for (uint16_t yi = 0; yi < h; yi++)
+  drawGlyph(gx, gy, font.bitmap + g.offset, g.width, g.height, (g.width + 7) >> 3, color, COLOR_CLEAR, size, textBlend, bgBlend);
+}
+
+int16_t penAdvance(const Font *font, uint8_t prev, uint8_t c, uint8_t size, int16_t &x)
+{
+  // Move the pen over a character, returning the right edge of what it
+  // covers, which includes glyphs that stick out past their advance
+  int16_t right = x;
+
+  if (font != NULL)
   {
-    uint16_t yw = yi*w;
-    for (uint16_t xi = 0; xi < w; xi++)
-    {
-      Color px = bitmap[yw + xi];
+    x += kerning(*font, prev, c) * size;
+    right = x;
 
-      if (px.a())
-        drawPixel(x + xi, y + yi, px, blend);
+    if (c >= font->first && c <= font->last)
+    {
+      const FontGlyph &g = font->glyphs[c - font->first];
+      right = x + (g.offsetX + g.width) * size;
     }
   }
+
+  x += charAdvance(font, c, size);
+  return max(right, x);
 }
 
-Color* DotMGBase::frameBuffer()
+int16_t lineWidth(const char *&c, const Font *font, uint8_t size)
 {
-  return frameBuf;
-}
+  // Measure up to the end of the line
+  int16_t x = 0, width = 0;
+  uint8_t prev = 0;
 
+  for (; *c && *c != '\n'; c++)
+  {
+    if (*c == '\r')
+      continue;
 
-/* Random */
+    int16_t right = penAdvance(font, prev, *c, size, x);
+    width = max(width, right);
+    prev = *c;
+  }
 
-unsigned long DotMGBase::generateRandomSeed()
-{
-  return micros();
+  return width;
 }
 
-void DotMGBase::initRandomSeed()
+void drawTextRun(int16_t x, int16_t y, const char *text, uint16_t length, const Font *font, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend)
 {
-  randomSeed(generateRandomSeed());
-}
+  // Skip lines above or below the clip rectangle in one go
+  int lineY = y + view.originY;
 
+  if (lineY >= view.clipY1 || lineY + lineHeight(font, size) <= view.clipY0)
+    return;
 
-/* Frame management */
+  // Stop once the pen is far enough past the right of the clip rectangle
+  // that nothing after it can reach back in, which matters when the clip
+  // rectangle is one tile of the draw list
+  int16_t reach = 0;
+  bool canStop = (font == NULL || fontReach(*font, reach));
+  int stopX = view.clipX1 - view.originX - reach*size;
+  uint8_t prev = 0;
 
-uint16_t DotMGBase::frameCount()
+  for (const char *c = text; c < text + length; c++)
+  {
+    if (*c == '\r')
+      continue;
+
+    if (canStop && x >= stopX)
+      break;
+
+    if (font == NULL)
+    {
+      DotMG::drawChar(x, y, *c, color, bg, size, textBlend, bgBlend);
+    }
+    else
+    {
+      x += kerning(*font, prev, *c) * size;
+      drawFontChar(*font, x + view.originX, lineY, *c, color, bg, size, textBlend, bgBlend);
+    }
+
+    x += charAdvance(font, *c, size);
+    prev = *c;
+  }
+}
+
+void drawText(int16_t x, int16_t y, const char *text, const Font *font, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend)
 {
-  return currFrame;
+  int16_t height = lineHeight(font, size);
+
+  for (const char *c = text; ; c++, y += height)
+  {
+    const char *line = c;
+
+    while (*c && *c != '\n')
+      c++;
+
+    drawTextRun(x, y, line, c - line, font, color, bg, size, textBlend, bgBlend);
+
+    if (*c == '\0')
+      break;
+  }
 }
 
-void DotMGBase::setFrameRate(uint8_t rate)
+void DotMG::drawString(int16_t x, int16_t y, const char *text)
 {
-  eachFrameMillis = 1000 / rate;
+  drawText(x, y, text, textFont, textColor, textBackground, textSize, textBlendFunc, textBgBlendFunc);
 }
 
-void DotMGBase::setFrameDuration(uint16_t duration)
+static void renderText(const DrawCommand &command)
 {
-  eachFrameMillis = duration;
+  const Font *font = (const Font *)command.extra;
+  drawText(command.x0, command.y0, (const char *)command.data, font, command.color, command.bg, command.size, command.blend, command.bgBlend);
 }
 
-bool DotMGBase::nextFrame()
+char* formatDigits(char *end, uint32_t value, uint8_t minDigits)
 {
-  uint16_t now = (uint16_t) millis();
-  uint16_t frameDurationMs = now - thisFrameStart;
+  // Digits are written backwards from the end of the buffer
+  char *p = end;
 
-  if (justRendered) {
-    lastFrameDurationMs = frameDurationMs;
-    justRendered = false;
-    return false;
+  while (value >= 100)
+  {
+    uint32_t q = value / 100;
+    const char *pair = digitPairs + (value - q*100) * 2;
+    *--p = pair[1];
+    *--p = pair[0];
+    value = q;
   }
-  else if (frameDurationMs < eachFrameMillis)
+
+  if (value >= 10)
   {
-    return false;
+    const char *pair = digitPairs + value * 2;
+    *--p = pair[1];
+    *--p = pair[0];
+  }
+  else
+  {
+    *--p = '0' + value;
   }
 
-  // pre-render
-  justRendered = true;
-  thisFrameStart = now;
-  currFrame++;
+  while (end - p < minDigits)
+    *--p = '0';
 
-  return true;
+  return p;
 }
 
-bool DotMGBase::everyXFrames(uint16_t frames)
+void drawDecimal(int16_t x, int16_t y, bool negative, uint32_t whole, uint32_t fraction, uint8_t decimals, uint8_t width, bool zeroPad)
 {
-  return currFrame % frames == 0;
+  char buffer[32];
+  char *end = buffer + sizeof(buffer) - 1;
+  char *p = end;
+
+  *end = '\0';
+  width = min(width, sizeof(buffer) - 1);
+
+  if (decimals > 0)
+  {
+    p = formatDigits(p, fraction, decimals);
+    *--p = '.';
+  }
+
+  p = formatDigits(p, whole, 1);
+
+  if (zeroPad)
+  {
+    while (end - p < width - negative)
+      *--p = '0';
+  }
+
+  if (negative)
+    *--p = '-';
+
+  while (end - p < width)
+    *--p = ' ';
+
+  drawText(x, y, p, textFont, textColor, textBackground, textSize, textBlendFunc, textBgBlendFunc);
 }
 
-int DotMGBase::cpuLoad()
+void DotMG::drawNumber(int16_t x, int16_t y, int32_t value, uint8_t width, bool zeroPad)
 {
-  return lastFrameDurationMs*100 / eachFrameMillis;
+  bool negative = value < 0;
+  uint32_t magnitude = negative ? 0U - (uint32_t)value : value;
+
+  drawDecimal(x, y, negative, magnitude, 0, 0, width, zeroPad);
 }
 
-uint8_t DotMGBase::actualFrameRate()
+void DotMG::drawFixed(int16_t x, int16_t y, int32_t value, uint8_t fractionBits, uint8_t decimals, uint8_t width, bool zeroPad)
 {
-  return 1000 / lastFrameDurationMs;
+  fractionBits = min(fractionBits, 16);
+  decimals = min(decimals, 4);
+
+  bool negative = value < 0;
+  uint32_t magnitude = negative ? 0U - (uint32_t)value : value;
+  uint32_t whole = magnitude >> fractionBits;
+  uint32_t fraction = magnitude & ((1UL << fractionBits) - 1);
+  uint32_t scale = powersOf10[decimals];
+
+  // Round the fraction to the decimals, which may carry into the whole part
+  fraction = (fraction * scale + ((1UL << fractionBits) >> 1)) >> fractionBits;
+
+  if (fraction >= scale)
+  {
+    fraction -= scale;
+    whole++;
+  }
+
+  // Don't draw a minus sign for a number that rounds to zero
+  negative = negative && (whole | fraction);
+  drawDecimal(x, y, negative, whole, fraction, decimals, width, zeroPad);
 }
 
-uint16_t DotMGBase::actualFrameDurationMs()
+bool DotMG::queueText(uint8_t layer, int16_t x, int16_t y, const char *text)
 {
-  return lastFrameDurationMs;
+  // The bounds clip the command when it's flushed, so they must hold glyphs
+  // that stick out of their cells as well as the cells
+  Rect extent = textBounds(text, textFont, textSize);
+
+  DrawCommand command;
+  command.render = renderText;
+  command.data = text;
+  command.x0 = x;
+  command.y0 = y;
+  command.left = x + extent.x;
+  command.top = y + extent.y;
+  command.x1 = command.right = command.left + extent.width;
+  command.y1 = command.bottom = command.top + extent.height;
+  command.extra = textFont;
+  command.color = textColor;
+  command.bg = textBackground;
+  command.blend = textBlendFunc;
+  command.bgBlend = textBgBlendFunc;
+  command.layer = layer;
+  command.size = textSize;
+  command.opaque = false;
+  return queueCommand(command);
 }
 
+Rect DotMG::measureText(const char *text)
+{
+  int16_t width = 0;
+  uint16_t lines = 1;
 
-/* Buttons */
+  for (const char *c = text; ; c++)
+  {
+    int16_t w = lineWidth(c, textFont, textSize);
+    width = max(width, w);
 
-bool DotMGBase::pressed(uint8_t buttons)
-{
-  return (buttonsState() & buttons) == buttons;
+    if (*c == '\0')
+      break;
+
+    lines++;
+  }
+
+  return Rect(0, 0, width, lines * lineHeight(textFont, textSize));
 }
 
-bool DotMGBase::notPressed(uint8_t buttons)
+uint8_t DotMG::layoutText(const char *text, int16_t width, uint8_t align, TextLine *lines, uint8_t maxLines)
 {
-  return (buttonsState() & buttons) == 0;
+  int16_t height = lineHeight(textFont, textSize);
+  const char *c = text;
+  uint8_t count = 0;
+
+  while (count < maxLines)
+  {
+    TextLine &line = lines[count];
+    line.text = c;
+    line.y = count * height;
+
+    // Add characters until one doesn't fit, remembering where the last run
+    // of spaces started as the place to break
+    const char *breakAt = NULL;
+    int16_t breakWidth = 0;
+    int16_t x = 0, right = 0;
+    uint8_t prev = 0;
+    bool wrapped = false;
+
+    for (; *c && *c != '\n'; c++)
+    {
+      if (*c == '\r')
+        continue;
+
+      if (*c == ' ' && prev != ' ')
+      {
+        breakAt = c;
+        breakWidth = right;
+      }
+
+      int16_t penX = x;
+      int16_t charRight = penAdvance(textFont, prev, *c, textSize, penX);
+
+      if (*c != ' ' && charRight > width && c > line.text)
+      {
+        wrapped = true;
+        break;
+      }
+
+      x = penX;
+      right = max(right, charRight);
+      prev = *c;
+    }
+
+    if (!wrapped && prev == ' ')
+    {
+      // Spaces at the end of a line don't take up room either
+      line.length = breakAt - line.text;
+      line.width = breakWidth;
+    }
+    else if (wrapped && breakAt != NULL)
+    {
+      // Drop the spaces at the break, and a line break right after them
+      line.length = breakAt - line.text;
+      line.width = breakWidth;
+
+      for (c = breakAt; *c == ' '; c++)
+        ;
+
+      if (*c == '\n')
+        c++;
+    }
+    else
+    {
+      line.length = c - line.text;
+      line.width = right;
+    }
+
+    if (align == TEXT_ALIGN_CENTER)
+      line.x = (width - line.width) / 2;
+    else if (align == TEXT_ALIGN_RIGHT)
+      line.x = width - line.width;
+    else
+      line.x = 0;
+
+    count++;
+
+    if (!wrapped)
+    {
+      if (*c == '\0')
+        break;
+
+      c++;
+    }
+  }
+
+  return count;
 }
 
-void DotMGBase::pollButtons()
+void DotMG::drawTextLines(int16_t x, int16_t y, const TextLine *lines, uint8_t count)
 {
-  previousButtonState = currentButtonState;
-  currentButtonState = buttonsState();
+  for (uint8_t i = 0; i < count; i++)
+  {
+    const TextLine &line = lines[i];
+    drawTextRun(x + line.x, y + line.y, line.text, line.length, textFont, textColor, textBackground, textSize, textBlendFunc, textBgBlendFunc);
+  }
 }
 
-bool DotMGBase::justPressed(uint8_t button)
+void charExtents(const char *text, size_t length, const Font *font, uint8_t size, int16_t *pen, int16_t *start, int16_t *left, int16_t *right)
 {
-  return (!(previousButtonState & button) && (currentButtonState & button));
+  // For each character of a line, find where the pen is before it, where it
+  // is drawn after kerning, and the leftmost and rightmost pixel columns of
+  // its glyph and background cell
+  int16_t x = 0;
+  uint8_t prev = 0;
+
+  for (size_t i = 0; i < length; i++)
+  {
+    pen[i] = x;
+
+    if (text[i] == '\r')
+    {
+      start[i] = left[i] = right[i] = x;
+      continue;
+    }
+
+    start[i] = left[i] = x;
+
+    if (font != NULL)
+    {
+      start[i] += kerning(*font, prev, text[i]) * size;
+      left[i] = start[i];
+
+      if ((uint8_t)text[i] >= font->first && (uint8_t)text[i] <= font->last)
+      {
+        int16_t glyphLeft = start[i] + font->glyphs[(uint8_t)text[i] - font->first].offsetX * size;
+        left[i] = min(left[i], glyphLeft);
+      }
+    }
+
+    right[i] = penAdvance(font, prev, text[i], size, x);
+    prev = text[i];
+  }
+
+  pen[length] = start[length] = left[length] = right[length] = x;
 }
 
-bool DotMGBase::justReleased(uint8_t button)
+Rect textBounds(const char *text, const Font *font, uint8_t size)
 {
-  return ((previousButtonState & button) && !(currentButtonState & button));
-}
+  // Find everything drawText() can draw: the character cells, and glyphs
+  // that stick out of them on any side
+  int16_t height = lineHeight(font, size);
+  int16_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+  int16_t y = 0;
 
-void DotMGBase::waitNoButtons() {
-  do {
-    delay(50); // simple button debounce
-  } while (buttonsState());
-}
+  for (const char *c = text; ; c++, y += height)
+  {
+    int16_t x = 0;
+    uint8_t prev = 0;
+
+    for (; *c && *c != '\n'; c++)
+    {
+      if (*c == '\r')
+        continue;
 
+      uint8_t ch = *c;
+      int16_t start = x;
 
-/* Collision */
+      if (font != NULL)
+      {
+        start += kerning(*font, prev, ch) * size;
+
+        if (ch >= font->first && ch <= font->last)
+        {
+          const FontGlyph &g = font->glyphs[ch - font->first];
+          int16_t gx = start + g.offsetX*size;
+          int16_t gy = y + (font->baseline + g.offsetY)*size;
+          int16_t gy1 = gy + g.height*size;
+
+          x0 = min(x0, gx);
+          y0 = min(y0, gy);
+          y1 = max(y1, gy1);
+        }
+      }
 
-bool DotMGBase::collide(Point point, Rect rect)
-{
-  return ((point.x >= rect.x) && (point.x < rect.x + rect.width) &&
-      (point.y >= rect.y) && (point.y < rect.y + rect.height));
+      x0 = min(x0, start);
+      int16_t right = penAdvance(font, prev, ch, size, x);
+      x1 = max(x1, right);
+      prev = ch;
+    }
+
+    if (*c == '\0')
+      break;
+  }
+
+  y1 = max(y1, y + height);
+  return Rect(x0, y0, x1 - x0, y1 - y0);
 }
 
-bool DotMGBase::collide(Rect rect1, Rect rect2)
+bool textCacheable(Color color, Color bg, BlendFunc textBlend, BlendFunc bgBlend)
 {
-  return !(rect2.x                >= rect1.x + rect1.width  ||
-           rect2.x + rect2.width  <= rect1.x                ||
-           rect2.y                >= rect1.y + rect1.height ||
-           rect2.y + rect2.height <= rect1.y);
+  // Without a background, the cache holds just the text, drawn with the text
+  // blending function. With one, it holds finished character cells, which
+  // only match drawString() when they don't depend on what's beneath: the
+  // background and the text must both replace what they're drawn over.
+  if (bg.a() == 0)
+    return true;
+
+  return bg.a() == 0xF && (bgBlend == BLEND_ALPHA || bgBlend == BLEND_NONE) &&
+         color.a() == 0xF && (textBlend == BLEND_ALPHA || textBlend == BLEND_NONE);
 }
 
-void swap(int16_t &a, int16_t &b)
+bool updateTextCache(TextCache &cache, const char *text)
 {
-  int16_t temp = a;
-  a = b;
-  b = temp;
-}
+  size_t length = strlen(text);
 
+  if (length > DOTMG_TEXT_CACHE_LENGTH)
+    return false;
 
-//====================================
-//========== class DotMG ==========
-//====================================
+  if (!textCacheable(textColor, textBackground, textBlendFunc, textBgBlendFunc))
+    return false;
 
-  static Color textColor = COLOR_WHITE;
-  static Color textBackground = COLOR_CLEAR;
-  static BlendFunc textBlendFunc = BLEND_ALPHA;
-  static BlendFunc textBgBlendFunc = BLEND_ALPHA;
-  static uint8_t textSize = 1;
-  static bool textWrap;
+  Rect extent = textBounds(text, textFont, textSize);
 
+  if (extent.width > cache.surface.width || extent.height > cache.surface.height)
+    return false;
 
-size_t DotMG::write(uint8_t c)
-{
-  if (c == '\n')
-  {
-    cursor_y += textSize * 8;
-    cursor_x = 0;
-  }
-  else if (c == '\r')
+  // Keep what's before the first changed character, unless the style changed
+  // or the text has several lines
+  size_t from = 0;
+
+  if (cache.size == textSize && cache.font == textFont &&
+      cache.color.value == textColor.value && cache.bg.value == textBackground.value &&
+      cache.blend == textBlendFunc && cache.bgBlend == textBgBlendFunc &&
+      cache.left == extent.x && cache.top == extent.y)
   {
-    // skip em
+    while (from < length && cache.text[from] == text[from])
+      from++;
+
+    if (from == length && cache.text[from] == '\0')
+      return true;
+
+    if (strchr(text, '\n') != NULL || strchr(cache.text, '\n') != NULL)
+      from = 0;
   }
-  else
+
+  int16_t clearX = 0;  // with from > 0
+  int16_t x = 0;
+
+  if (from > 0)
   {
-    drawChar(cursor_x, cursor_y, c, textColor, textBackground, textSize);
-    cursor_x += textSize * 6;
-    if (textWrap && (cursor_x > (WIDTH - textSize * 6)))
+    // Only the columns right of the pen at `from` are cleared and redrawn, so
+    // back up until nothing before it reaches right of the pen and nothing
+    // from it onwards, in the old or new text, reaches left of it. Glyphs can
+    // stick out of their cells, and kerning can move them left.
+    const size_t n = DOTMG_TEXT_CACHE_LENGTH + 1;
+    int16_t pen[n], start[n], left[n], right[n];
+    int16_t oldPen[n], oldStart[n], oldLeft[n], oldRight[n];
+    size_t oldLength = strlen(cache.text);
+
+    charExtents(text, length, textFont, textSize, pen, start, left, right);
+    charExtents(cache.text, oldLength, textFont, textSize, oldPen, oldStart, oldLeft, oldRight);
+
+    int16_t reachLeft = pen[from];
+
+    for (size_t i = from; i < length; i++)
+      reachLeft = min(reachLeft, left[i]);
+    for (size_t i = from; i < oldLength; i++)
+      reachLeft = min(reachLeft, oldLeft[i]);
+
+    for (; from > 0; from--)
     {
-      // calling ourselves recursively for 'newline' is
-      // 12 bytes smaller than doing the same math here
-      write('\n');
+      int16_t reachRight = pen[from];
+
+      for (size_t i = 0; i < from; i++)
+        reachRight = max(reachRight, right[i]);
+
+      if (reachLeft >= pen[from] && reachRight <= pen[from])
+        break;
+
+      // Characters before `from` are the same in both texts
+      reachLeft = min(reachLeft, left[from - 1]);
     }
+
+    clearX = pen[from];
+    x = start[from];
   }
-  return 1;
+
+  // Render into the cache without blending, so that it holds the colors
+  // themselves, with the text position at -extent.x, -extent.y
+  Surface savedTarget = target;
+  View savedView = view;
+
+  target = cache.surface;
+  view.clipX0 = view.clipY0 = 0;
+  view.originX = -extent.x;
+  view.originY = -extent.y;
+  view.clipX1 = target.width;
+  view.clipY1 = target.height;
+
+  fillClippedRect(from > 0 ? clearX - extent.x : 0, 0, max(cache.width, extent.width), max(cache.height, extent.height), COLOR_CLEAR, BLEND_NONE);
+
+  if (from > 0)
+    drawTextRun(x, 0, text + from, length - from, textFont, textColor, textBackground, textSize, BLEND_NONE, BLEND_NONE);
+  else
+    drawText(0, 0, text, textFont, textColor, textBackground, textSize, BLEND_NONE, BLEND_NONE);
+
+  target = savedTarget;
+  view = savedView;
+
+  memcpy(cache.text, text, length + 1);
+  cache.font = textFont;
+  cache.color = textColor;
+  cache.bg = textBackground;
+  cache.blend = textBlendFunc;
+  cache.bgBlend = textBgBlendFunc;
+  cache.size = textSize;
+  cache.left = extent.x;
+  cache.top = extent.y;
+  cache.width = extent.width;
+  cache.height = extent.height;
+  return true;
 }
 
-void DotMG::drawChar(int16_t x, int16_t y, unsigned char c, Color color, Color bg, uint8_t size, BlendFunc textBlend, BlendFunc bgBlend)
+void DotMG::drawCachedText(int16_t x, int16_t y, TextCache &cache, const char *text)
 {
-  uint8_t line;
-  const unsigned char* bitmap = font + c * 5;
-
-  if ((x >= WIDTH) ||              // Clip right
-      (y >= HEIGHT) ||             // Clip bottom
-      ((x + 5 * size - 1) < 0) ||  // Clip left
-      ((y + 8 * size - 1) < 0)     // Clip top
-     )
+  if (!updateTextCache(cache, text))
   {
+    drawString(x, y, text);
     return;
   }
 
-  for (uint8_t i = 0; i < 6; i++ )
-  {
-    line = *(bitmap++);
-    if (i == 5) {
-      line = 0x0;
-    }
+  drawSurface(x + cache.left, y + cache.top, cache.surface.subsurface(0, 0, cache.width, cache.height), textBlendFunc);
+}
 
-    for (uint8_t j = 0; j < 8; j++)
-    {
-      Color draw_color = (line & 0x1) ? color : bg;
-      BlendFunc blend = (line & 0x1) ? textBlend : bgBlend;
+void DotMG::setFont(const Font *font)
+{
+  textFont = font;
+  lastCursorX = -1;
+}
 
-      if (draw_color.a()) {
-        for (uint8_t a = 0; a < size; a++ ) {
-          for (uint8_t b = 0; b < size; b++ ) {
-            drawPixel(x + (i * size) + a, y + (j * size) + b, draw_color, blend);
-          }
-        }
-      }
-      line >>= 1;
-    }
-  }
+const Font* DotMG::getFont()
+{
+  return textFont;
 }
 
 void DotMG::setCursor(int16_t x, int16_t y)
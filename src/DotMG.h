@@ -12,8 +12,86 @@
 #include "DotMGCore.h"
 #include "Color.h"
 #include "Blending.h"
+#include "FixedPoint.h"
 #include <Print.h>
 
+// Number of views that can be saved with pushClipRect(), pushTranslation()
+// and pushViewport()
+#ifndef DOTMG_VIEW_STACK_SIZE
+  #define DOTMG_VIEW_STACK_SIZE 8
+#endif
+
+// Maximum number of commands in the deferred draw list
+#ifndef DOTMG_DRAW_LIST_SIZE
+  #define DOTMG_DRAW_LIST_SIZE 128
+#endif
+
+// Width and height of the screen tiles the deferred draw list is rendered in
+#ifndef DOTMG_DRAW_TILE_SIZE
+  #define DOTMG_DRAW_TILE_SIZE 32
+#endif
+
+// Maximum number of sprites in the sprite pool (see DotMGBase::addSprite())
+#ifndef DOTMG_SPRITE_CAPACITY
+  #define DOTMG_SPRITE_CAPACITY 256
+#endif
+
+// Number of compositing layers (see DotMGBase::setLayer())
+#ifndef DOTMG_LAYER_COUNT
+  #define DOTMG_LAYER_COUNT 4
+#endif
+
+// Longest text a TextCache holds (see DotMG::drawCachedText())
+#ifndef DOTMG_TEXT_CACHE_LENGTH
+  #define DOTMG_TEXT_CACHE_LENGTH 31
+#endif
+
+// Bitmap orientation flags (see DotMGBase::drawBitmap())
+
+#define BITMAP_FLIP_X      0x01
+#define BITMAP_FLIP_Y      0x02
+#define BITMAP_ROTATE_90   0x04
+#define BITMAP_ROTATE_180  (BITMAP_FLIP_X | BITMAP_FLIP_Y)
+#define BITMAP_ROTATE_270  (BITMAP_ROTATE_90 | BITMAP_FLIP_X | BITMAP_FLIP_Y)
+
+// Run-length encoded sprite runs (see DotMGBase::drawSprite())
+
+#define SPRITE_RUN_SKIP         0x0000
+#define SPRITE_RUN_OPAQUE       0x4000
+#define SPRITE_RUN_TRANSLUCENT  0x8000
+#define SPRITE_RUN_TYPE_MASK    0xC000
+#define SPRITE_RUN_LENGTH_MASK  0x3FFF
+
+// Sprite pool flags, in addition to the bitmap orientation flags
+
+#define SPRITE_HIDDEN  0x80
+
+// Screen filters (see DotMGBase::setScreenFilter())
+
+#define SCREEN_GRAYSCALE  0x01
+#define SCREEN_INVERT     0x02
+
+// Tile map cell bits (see DotMGBase::drawTileMap())
+
+#define TILE_INDEX_MASK  0x1FFF
+#define TILE_FLIP_X      (BITMAP_FLIP_X << 13)
+#define TILE_FLIP_Y      (BITMAP_FLIP_Y << 13)
+#define TILE_ROTATE_90   (BITMAP_ROTATE_90 << 13)
+#define TILE_NONE        TILE_INDEX_MASK
+
+// Per-tile flags of a tileset
+
+#define TILE_OPAQUE      0x01  // Every pixel of the tile is opaque
+#define TILE_EMPTY       0x02  // Every pixel of the tile is transparent
+#define TILE_SOLID       0x04  // The tile blocks movement (see Collision.h)
+#define TILE_SLOPE_UP    0x08  // The tile's floor rises from left to right
+#define TILE_SLOPE_DOWN  0x10  // The tile's floor falls from left to right
+
+// Text alignment (see DotMG::layoutText())
+
+#define TEXT_ALIGN_LEFT    0
+#define TEXT_ALIGN_CENTER  1
+#define TEXT_ALIGN_RIGHT   2
 
 //=============================================
 //========== Rect (rectangle) object ==========
@@ -76,6 +154,516 @@ struct Point
    * \param y The Y coordinate of the point. Copied to variable `y`.
    */
   Point(int16_t x, int16_t y);
+
+  /** \brief
+   * Convert a fixed point vector, rounding its components down.
+   *
+   * \param v The vector to convert.
+   */
+  Point(const FixedVector &v);
+};
+
+//====================================
+//========== Surface object ==========
+//====================================
+
+/** \brief
+ * An image in RAM that can be drawn into and drawn from.
+ *
+ * \details
+ * Pixels are arranged like `DotMGBase::frameBuffer()`: row after row,
+ * starting at the top left. Rows start `stride` pixels apart, which lets a
+ * surface be part of a larger image (see `subsurface()`).
+ *
+ * Draw into a surface by making it the draw target with
+ * `DotMGBase::setDrawTarget()`, and draw it with `DotMGBase::drawSurface()`.
+ * Something that is costly to draw but rarely changes, like a text panel or
+ * a minimap, can be drawn into a surface once and then copied each frame.
+ *
+ * example:
+ * \code{.cpp}
+ * Color panelPixels[64*24];
+ * Surface panel(panelPixels, 64, 24);
+ *
+ * dmg.setDrawTarget(&panel);
+ * dmg.fillRoundRect(0, 0, 64, 24, 4, COLOR_BLUE);
+ * dmg.setDrawTarget(NULL);
+ *
+ * // every frame
+ * dmg.drawSurface(48, 4, panel);
+ * \endcode
+ */
+struct Surface
+{
+  Color *pixels;   /**< The top left pixel */
+  uint16_t width;  /**< The width in pixels */
+  uint16_t height; /**< The height in pixels */
+  uint16_t stride; /**< The distance between the starts of two rows, in pixels */
+
+  /** \brief
+   * The default constructor
+   */
+  Surface() = default;
+
+  /** \brief
+   * The fully initializing constructor
+   *
+   * \param pixels The top left pixel. Copied to variable `pixels`.
+   * \param width The width in pixels. Copied to variable `width`.
+   * \param height The height in pixels. Copied to variable `height`.
+   * \param stride The distance between the starts of two rows, in pixels
+   * (optional; 0 means `width`). Copied to variable `stride`.
+   */
+  Surface(Color *pixels, uint16_t width, uint16_t height, uint16_t stride = 0);
+
+  /** \brief
+   * Get a surface for a rectangle within this one, sharing its pixels.
+   *
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   *
+   * \return The part of the rectangle inside this surface.
+   */
+  Surface subsurface(int16_t x, int16_t y, uint16_t w, uint16_t h) const;
+};
+
+//===========================================
+//========== ScanlineEffect object ==========
+//===========================================
+
+/** \brief
+ * Effects applied to one row of the screen as it is sent to the display.
+ *
+ * \details
+ * See `DotMGBase::setScanlineCallback()`.
+ */
+struct ScanlineEffect
+{
+  int16_t offset;     /**< Shifts the row right by this many pixels (left if negative), wrapping around */
+  Color tint;         /**< A color mixed into the row, by its alpha; `COLOR_CLEAR` for none */
+  uint8_t brightness; /**< From 0 (black) to 255 (unchanged) */
+};
+
+/** \brief
+ * Sets up the effects for one row of the screen.
+ *
+ * \param y The Y coordinate of the row.
+ * \param effect The effects for the row, to change as needed. They start
+ * out with no effect, or with the offset from `DotMGBase::setScanlineOffsets()`.
+ */
+typedef void (*ScanlineFunc)(int16_t y, ScanlineEffect &effect);
+
+//=========================================
+//========== AffineMatrix object ==========
+//=========================================
+
+/** \brief
+ * A 2x3 fixed-point matrix for drawing transformed bitmaps.
+ *
+ * \details
+ * The matrix maps a point `x`, `y` of a bitmap to the point `x'`, `y'` on the
+ * screen:
+ *
+ *     x' = a*x + b*y + tx
+ *     y' = c*x + d*y + ty
+ *
+ * All values are in 16.16 fixed point, where 1.0 is `0x10000`.
+ *
+ * Matrices can be combined with `*`: `A * B` transforms by `B` first, then
+ * by `A`.
+ *
+ * example:
+ * \code{.cpp}
+ * // draw a 16x16 bitmap at 2x size, rotated around its center, centered at 80, 64
+ * AffineMatrix m = AffineMatrix::translation(80, 64) *
+ *                  AffineMatrix::rotationAngle(angle) *
+ *                  AffineMatrix::scaling(0x20000, 0x20000) *
+ *                  AffineMatrix::translation(-8, -8);
+ * dmg.drawBitmapAffine(bitmap, 16, 16, m);
+ * \endcode
+ */
+struct AffineMatrix
+{
+  int32_t a;  /**< The X scale/rotation term applied to X */
+  int32_t b;  /**< The X shear/rotation term applied to Y */
+  int32_t c;  /**< The Y shear/rotation term applied to X */
+  int32_t d;  /**< The Y scale/rotation term applied to Y */
+  int32_t tx; /**< The X translation */
+  int32_t ty; /**< The Y translation */
+
+  /** \brief
+   * Get a matrix that leaves points unchanged.
+   */
+  static AffineMatrix identity();
+
+  /** \brief
+   * Get a matrix that moves points.
+   *
+   * \param x The distance to move along X, in pixels.
+   * \param y The distance to move along Y, in pixels.
+   */
+  static AffineMatrix translation(int16_t x, int16_t y);
+
+  /** \brief
+   * Get a matrix that scales points away from 0, 0.
+   *
+   * \param sx The X scale, in 16.16 fixed point.
+   * \param sy The Y scale, in 16.16 fixed point.
+   */
+  static AffineMatrix scaling(int32_t sx, int32_t sy);
+
+  /** \brief
+   * Get a matrix that rotates points clockwise around 0, 0.
+   *
+   * \param radians The angle to rotate by.
+   */
+  static AffineMatrix rotation(float radians);
+
+  /** \brief
+   * Get a matrix that rotates points clockwise around 0, 0.
+   *
+   * \param angle The angle to rotate by, where a full turn is 0x10000.
+   *
+   * \details
+   * This avoids floating point math entirely. See `Angle`.
+   */
+  static AffineMatrix rotationAngle(Angle angle);
+
+  /** \brief
+   * Get the matrix that undoes this one.
+   *
+   * \details
+   * A matrix that squashes everything onto a line or point can't be undone.
+   * In that case all values of the returned matrix are zero.
+   */
+  AffineMatrix inverse() const;
+
+  /** \brief
+   * Combine two matrices into one that transforms by `other`, then by this one.
+   */
+  AffineMatrix operator*(const AffineMatrix &other) const;
+};
+
+/** \brief
+ * The source position and step for one row drawn by
+ * `DotMGBase::drawBitmapScanlines()`.
+ *
+ * \details
+ * All values are in 16.16 fixed point bitmap pixels.
+ */
+struct AffineScanline
+{
+  int32_t u;  /**< The bitmap X coordinate sampled at the center of X coordinate 0 */
+  int32_t v;  /**< The bitmap Y coordinate sampled at the center of X coordinate 0 */
+  int32_t du; /**< The change of `u` from one pixel to the next */
+  int32_t dv; /**< The change of `v` from one pixel to the next */
+};
+
+/** \brief
+ * Sets up the source position and step for one row drawn by
+ * `DotMGBase::drawBitmapScanlines()`.
+ *
+ * \param y The Y coordinate of the row.
+ * \param line The scanline to fill in.
+ *
+ * \return `false` to leave the row untouched.
+ */
+typedef bool (*AffineScanlineFunc)(int16_t y, AffineScanline &line);
+
+//========================================
+//========== SpriteAtlas object ==========
+//========================================
+
+/** \brief
+ * One frame of a sprite atlas.
+ *
+ * \details
+ * Transparent borders are trimmed from frames when the atlas is built, so
+ * only the trimmed pixels are stored in the atlas image. The untrimmed frame
+ * size and the position of the trimmed pixels within it are kept so that
+ * animation frames of different trimmed sizes still line up.
+ */
+struct AtlasFrame
+{
+  uint16_t x;           /**< The X coordinate of the trimmed pixels in the atlas image */
+  uint16_t y;           /**< The Y coordinate of the trimmed pixels in the atlas image */
+  uint16_t width;       /**< The width of the trimmed pixels */
+  uint16_t height;      /**< The height of the trimmed pixels */
+  int16_t offsetX;      /**< The X coordinate of the trimmed pixels within the untrimmed frame */
+  int16_t offsetY;      /**< The Y coordinate of the trimmed pixels within the untrimmed frame */
+  uint16_t frameWidth;  /**< The width of the untrimmed frame */
+  uint16_t frameHeight; /**< The height of the untrimmed frame */
+  int16_t pivotX;       /**< The X coordinate of the pivot within the untrimmed frame */
+  int16_t pivotY;       /**< The Y coordinate of the pivot within the untrimmed frame */
+};
+
+/** \brief
+ * A sprite atlas: many frames packed into one image, plus a frame table.
+ *
+ * \details
+ * Atlases are usually created by `extras/img2dotmg.py` with the `--atlas`
+ * option, and drawn with `DotMGBase::drawFrame()`.
+ */
+struct SpriteAtlas
+{
+  const Color *image;       /**< The atlas image, arranged like a bitmap */
+  uint16_t width;           /**< The width of the atlas image */
+  uint16_t height;          /**< The height of the atlas image */
+  uint16_t frameCount;      /**< The number of frames */
+  const AtlasFrame *frames; /**< The frame table */
+};
+
+//====================================
+//========== TileMap object ==========
+//====================================
+
+/** \brief
+ * An animated tile of a tileset.
+ *
+ * \details
+ * The frames of the animation are consecutive tiles of the tileset, starting
+ * with `first`. Map cells that contain `first` show the current frame.
+ */
+struct TileAnimation
+{
+  uint16_t first;   /**< The index of the first frame tile */
+  uint8_t frames;   /**< The number of frame tiles */
+  uint8_t duration; /**< The number of display frames each frame tile is shown for */
+};
+
+/** \brief
+ * A set of equally sized tiles for tile maps.
+ *
+ * \details
+ * The pixels of each tile are stored one tile after another, each tile
+ * arranged like a bitmap of `tileWidth` by `tileHeight` pixels. Tilesets are
+ * usually created by `extras/img2dotmg.py` with the `--tileset` option,
+ * which also builds the flag table.
+ *
+ * The flag table holds one byte per tile. `TILE_OPAQUE` tiles are copied
+ * row by row without looking at their pixels, and `TILE_EMPTY` tiles are
+ * skipped. `TILE_SOLID`, `TILE_SLOPE_UP` and `TILE_SLOPE_DOWN` are used by
+ * the tile map collision functions of Collision.h. The remaining bits are
+ * free for game use.
+ */
+struct Tileset
+{
+  const Color *image;                /**< The tile pixels */
+  uint16_t tileWidth;                /**< The width of a tile */
+  uint16_t tileHeight;               /**< The height of a tile */
+  uint16_t tileCount;                /**< The number of tiles */
+  const uint8_t *flags;              /**< The flag table, or `NULL` */
+  const TileAnimation *animations;   /**< The animated tiles, or `NULL` */
+  uint8_t animationCount;            /**< The number of animated tiles */
+};
+
+/** \brief
+ * A grid of tiles drawn from a tileset.
+ *
+ * \details
+ * Each cell holds a tile index in its low bits (`TILE_INDEX_MASK`), optionally
+ * combined with `TILE_FLIP_X`, `TILE_FLIP_Y` and `TILE_ROTATE_90`, which
+ * orient the tile like the matching `BITMAP_*` flags. Rotated tiles should
+ * be square. Cells with an index past the end of the tileset, such as
+ * `TILE_NONE`, are empty.
+ */
+struct TileMap
+{
+  const uint16_t *cells;   /**< The cells, one row after another */
+  uint16_t width;          /**< The number of columns */
+  uint16_t height;         /**< The number of rows */
+  const Tileset *tileset;  /**< The tileset */
+};
+
+//===================================
+//========== Sprite object ==========
+//===================================
+
+/** \brief
+ * A sprite in the sprite pool.
+ *
+ * \details
+ * Sprites are added with `DotMGBase::addSprite()`, which returns an ID. The
+ * sprite can then be moved, animated or changed through the pointer returned
+ * by `DotMGBase::getSprite()`, and all sprites are drawn with a single call
+ * to `DotMGBase::drawSprites()`.
+ */
+struct Sprite
+{
+  const SpriteAtlas *atlas; /**< The sprite atlas the frame is taken from */
+  int16_t x;                /**< The X coordinate the frame's pivot is drawn at */
+  int16_t y;                /**< The Y coordinate the frame's pivot is drawn at */
+  uint16_t frame;           /**< The index of the frame in the atlas */
+  uint8_t layer;            /**< Sprites in higher layers are drawn on top */
+  uint8_t flags;            /**< Orientation flags (see `DotMGBase::drawBitmap()`), plus `SPRITE_HIDDEN` */
+  BlendFunc blend;          /**< The blending function */
+};
+
+//=================================
+//========== Font object ==========
+//=================================
+
+/** \brief
+ * One character of a proportional font.
+ *
+ * \details
+ * The glyph's pixels are stored in the font bitmap as `height` rows of
+ * `(width + 7) / 8` bytes each. The lowest bit of a byte is the leftmost
+ * pixel.
+ */
+struct FontGlyph
+{
+  uint16_t offset; /**< The byte offset of the glyph's rows in the font bitmap */
+  uint8_t width;   /**< The width of the glyph bitmap */
+  uint8_t height;  /**< The height of the glyph bitmap */
+  int8_t offsetX;  /**< The X coordinate of the glyph bitmap, relative to the pen position */
+  int8_t offsetY;  /**< The Y coordinate of the glyph bitmap, relative to the baseline */
+  uint8_t advance; /**< How far the pen moves after the character */
+};
+
+/** \brief
+ * A kerning pair of a proportional font.
+ */
+struct FontKerning
+{
+  uint8_t left;  /**< The first character of the pair */
+  uint8_t right; /**< The character following it */
+  int8_t amount; /**< Added to the pen position before drawing `right` */
+};
+
+/** \brief
+ * A proportional bitmap font.
+ *
+ * \details
+ * Fonts are usually created by `extras/font2dotmg.py`, and used with
+ * `DotMG::setFont()`. Characters outside `first` to `last` are not drawn and
+ * take up no space.
+ */
+struct Font
+{
+  const uint8_t *bitmap;      /**< The packed rows of all glyphs */
+  const FontGlyph *glyphs;    /**< The glyphs of characters `first` to `last` */
+  uint8_t first;              /**< The first character in the font */
+  uint8_t last;               /**< The last character in the font */
+  uint8_t lineHeight;         /**< The distance between lines */
+  uint8_t baseline;           /**< The distance from the top of a line to the baseline */
+  const FontKerning *kerning; /**< Kerning pairs, sorted by `left` then `right`, or `NULL` */
+  uint16_t kerningCount;      /**< The number of kerning pairs */
+};
+
+/** \brief
+ * One line of text laid out by `DotMG::layoutText()`.
+ *
+ * \details
+ * A line refers to its characters in the original text, which isn't copied.
+ * Lines only hold geometry, so they can be kept and drawn again with
+ * `DotMG::drawTextLines()` for as long as the text, font and text size stay
+ * the same.
+ */
+struct TextLine
+{
+  const char *text; /**< The first character of the line */
+  uint16_t length;  /**< The number of characters in the line, without the line break */
+  int16_t x;        /**< The X offset of the line, after alignment */
+  int16_t y;        /**< The Y offset of the top of the line */
+  int16_t width;    /**< The width of the line, in pixels */
+};
+
+//======================================
+//========== TextCache object ==========
+//======================================
+
+/** \brief
+ * Pixels of text kept from frame to frame by `DotMG::drawCachedText()`.
+ *
+ * \details
+ * The cache renders its text into pixels provided by the sketch, which must
+ * be large enough for the text at the text size used. A score label of up to
+ * eight characters in the built-in font at size 1, for example:
+ *
+ * \code{.cpp}
+ * Color scorePixels[48 * 8];
+ * TextCache scoreText(scorePixels, 48, 8);
+ * \endcode
+ */
+struct TextCache
+{
+  Surface surface;                          /**< Where the text is rendered */
+  char text[DOTMG_TEXT_CACHE_LENGTH + 1];   /**< The text that was rendered */
+  const Font *font;                         /**< The font it was rendered with */
+  Color color;                              /**< The text color it was rendered with */
+  Color bg;                                 /**< The background color it was rendered with */
+  BlendFunc blend;                          /**< The text blending function it was rendered for */
+  BlendFunc bgBlend;                        /**< The background blending function it was rendered for */
+  uint8_t size;                             /**< The text size it was rendered with, or 0 if nothing is cached */
+  int16_t left;                             /**< The X offset of the rendered pixels from the text position */
+  int16_t top;                              /**< The Y offset of the rendered pixels from the text position */
+  uint16_t width;                           /**< The width of the rendered text */
+  uint16_t height;                          /**< The height of the rendered text */
+
+  /** \brief
+   * The default constructor
+   */
+  TextCache() = default;
+
+  /** \brief
+   * The initializing constructor
+   *
+   * \param pixels The pixels to render text into, `width` * `height` of them.
+   * \param width The width of the pixels.
+   * \param height The height of the pixels.
+   */
+  TextCache(Color *pixels, uint16_t width, uint16_t height);
+
+  /** \brief
+   * Forget the rendered text, so that it is rendered again when next drawn.
+   *
+   * \details
+   * Needed only if the pixels were changed by something else.
+   */
+  void invalidate();
+};
+
+//========================================
+//========== DrawCommand object ==========
+//========================================
+
+/** \brief
+ * A drawing operation stored in the deferred draw list.
+ *
+ * \details
+ * Commands are normally created by the `queue*()` functions of DotMGBase and
+ * DotMG. A custom command can be queued with `DotMGBase::queueCommand()` by
+ * filling in the fields it needs and a `render` function that draws it.
+ *
+ * All coordinates are given relative to the view that is active when the
+ * command is queued. When rendered, they have been converted to screen
+ * coordinates and the view has been set up so that drawing functions use them
+ * as-is, clipped to the part of the screen being rendered.
+ */
+struct DrawCommand
+{
+  void (*render)(const DrawCommand &command); /**< The function that draws the command */
+  const void *data;  /**< Pixels, text, or other data used by the command */
+  const void *extra; /**< More data used by the command, e.g. the font of text commands */
+  int16_t x0;        /**< The first X coordinate of the command's geometry */
+  int16_t y0;        /**< The first Y coordinate of the command's geometry */
+  int16_t x1;        /**< The second X coordinate of the command's geometry */
+  int16_t y1;        /**< The second Y coordinate of the command's geometry */
+  int16_t left;      /**< The left edge of the area the command can draw in */
+  int16_t top;       /**< The top edge of the area the command can draw in */
+  int16_t right;     /**< The right edge (exclusive) of the area the command can draw in */
+  int16_t bottom;    /**< The bottom edge (exclusive) of the area the command can draw in */
+  Color color;       /**< The foreground color */
+  Color bg;          /**< The background color */
+  BlendFunc blend;   /**< The foreground blending function */
+  BlendFunc bgBlend; /**< The background blending function */
+  uint8_t layer;     /**< Commands in lower layers are drawn first */
+  uint8_t size;      /**< The text size, for text commands */
+  uint8_t flags;     /**< The orientation flags, for bitmap commands */
+  bool opaque;       /**< `true` if the command hides everything beneath its whole area */
 };
 
 //==================================
@@ -111,9 +699,115 @@ class DotMGBase : public DotMGCore
    * Sends the contents of the frame buffer to the display.
    *
    * \param clear If set to `true`, clears the frame buffer after sending.
+   *
+   * \details
+   * Any commands in the deferred draw list are rendered first, on top of
+   * everything drawn directly into the frame buffer (see `flushDrawList()`).
    */
   static void display(bool clear = true);
 
+  /** \brief
+   * Sets a function to set up effects for each row as the screen is sent.
+   *
+   * \param func The function, called once for each row by `display()`. Set
+   * to `NULL` to remove.
+   *
+   * \details
+   * Effects are applied while `display()` translates the frame buffer for the
+   * display, so they add no separate pass over the screen, and the frame
+   * buffer itself is not changed. This allows classic raster effects: wavy
+   * rows, per-row color gradients, and dimmed or highlighted bands.
+   *
+   * Tint and brightness are applied through small per-channel tables built
+   * once per row, so they cost the same however many pixels there are.
+   *
+   * example:
+   * \code{.cpp}
+   * bool underwater;
+   *
+   * void waterEffect(int16_t y, ScanlineEffect &effect) {
+   *   if (y > 80) {
+   *     effect.offset = (y + dmg.frameCount()/2) % 4 - 2;
+   *     effect.tint = Color(0, 4, 15, 6);
+   *   }
+   * }
+   *
+   * dmg.setScanlineCallback(waterEffect);
+   * \endcode
+   */
+  static void setScanlineCallback(ScanlineFunc func);
+
+  /** \brief
+   * Shift rows of the screen by amounts from a table as the screen is sent.
+   *
+   * \param offsets The offsets, in pixels (see `ScanlineEffect::offset`). Set
+   * to `NULL` to remove.
+   * \param length The number of offsets. Defaults to screen height.
+   * \param phase The offset used for the top row (optional; defaults to 0).
+   *
+   * \details
+   * Row `y` is shifted by `offsets[(y + phase) % length]`, so a short table
+   * repeats down the screen, and changing `phase` every frame makes the
+   * pattern move. No function is called per row. If a scanline callback is
+   * also set, it sees the offset from the table and can change it.
+   *
+   * The table is not copied and must stay valid while it is set.
+   */
+  static void setScanlineOffsets(const int8_t offsets[], uint16_t length = HEIGHT, uint16_t phase = 0);
+
+  /** \brief
+   * Fade the whole screen towards a color.
+   *
+   * \param amount From 0 (no fade) to 255 (the screen is all `color`).
+   * \param color The color to fade to (optional; defaults to `COLOR_BLACK`).
+   *
+   * \details
+   * Screen effects (`setScreenFade()`, `setScreenTint()` and
+   * `setScreenFilter()`) are applied by `display()` while it translates the
+   * frame buffer for the display, through small per-channel tables that are
+   * only rebuilt when an effect changes. They cost nothing beyond that
+   * translation and leave the frame buffer untouched, so a fade or a flash
+   * needs no drawing at all. They apply to the composited layers and on top
+   * of any scanline tint and brightness, except grayscale, which comes first.
+   *
+   * example:
+   * \code{.cpp}
+   * // fade out over about a second
+   * if (dmg.screenFade() < 255) {
+   *   dmg.setScreenFade(min(dmg.screenFade() + 4, 255));
+   * }
+   * \endcode
+   */
+  static void setScreenFade(uint8_t amount, Color color = COLOR_BLACK);
+
+  /** \brief
+   * Get the current screen fade amount.
+   *
+   * \return The amount set by `setScreenFade()`.
+   */
+  static uint8_t screenFade();
+
+  /** \brief
+   * Tint the whole screen by multiplying it with a color.
+   *
+   * \param color The tint. `COLOR_WHITE` for none; its alpha channel is ignored.
+   *
+   * \details
+   * See `setScreenFade()`.
+   */
+  static void setScreenTint(Color color);
+
+  /** \brief
+   * Show the whole screen in grayscale and/or inverted.
+   *
+   * \param filter `SCREEN_GRAYSCALE` and/or `SCREEN_INVERT`, or 0 for none.
+   *
+   * \details
+   * Grayscale is applied first, then inversion, then the tint and the fade.
+   * See `setScreenFade()`.
+   */
+  static void setScreenFilter(uint8_t filter);
+
   /** \brief
    * Sets the background color to use when clearing the screen.
    *
@@ -167,24 +861,286 @@ class DotMGBase : public DotMGCore
     /** \brief
    * Get the current background image width.
    *
-   * \return The current background image width. Returns zero if none is set.
+   * \return The current background image width. Returns zero if none is set.
+   */
+  static uint16_t backgroundImageWidth();
+
+  /** \brief
+   * Get the current background image height.
+   *
+   * \return The current background image height. Returns zero if none is set.
+   */
+  static uint16_t backgroundImageHeight();
+
+  /** \brief
+   * Get the current background image blending function.
+   *
+   * \return The current background image blending function. Returns `BLEND_ALPHA`
+   * if none is set.
+   */
+  static BlendFunc backgroundImageBlendFunc();
+
+  /** \brief
+   * Sets a tile map to use as the background when clearing the screen.
+   *
+   * \param map The background tile map. Set to `NULL` to remove.
+   * \param cameraX The X coordinate within the map shown at the left edge of the screen.
+   * \param cameraY The Y coordinate within the map shown at the top edge of the screen.
+   *
+   * \details
+   * The tile map replaces the background image (see `setBackgroundImage()`)
+   * while it is set. `clear()` and `display()` redraw it over the background
+   * color with `drawTileMap()`, so opaque tiles are copied straight into the
+   * frame buffer instead of being looked up pixel by pixel.
+   *
+   * Call this again with a new camera position to scroll the background.
+   * The map is not copied and must stay valid while it is set.
+   */
+  static void setBackgroundTileMap(const TileMap *map, int16_t cameraX = 0, int16_t cameraY = 0);
+
+  /** \brief
+   * Get the current background tile map.
+   *
+   * \return A pointer to the current background tile map. Returns `NULL` if none is set.
+   */
+  static const TileMap* backgroundTileMap();
+
+  /** \brief
+   * Sets up a compositing layer, which keeps its contents from frame to frame.
+   *
+   * \param layer The layer index, from 0 to `DOTMG_LAYER_COUNT` - 1.
+   * \param pixels The layer's pixels, arranged like `frameBuffer()`. Set to `NULL` to remove the layer.
+   * \param width The layer width. Defaults to screen width.
+   * \param height The layer height. Defaults to screen height.
+   * \param above If `true`, the layer is shown in front of the frame buffer
+   * instead of behind it (optional; defaults to `false`).
+   *
+   * \details
+   * Layers are merged with the frame buffer by `display()` while it converts
+   * each row for the display, so they cost no extra pass over the screen and
+   * never need to be redrawn unless their contents change. Typical uses are
+   * a static background behind the frame buffer and a HUD in front of it.
+   *
+   * Layers behind the frame buffer are only seen through transparent frame
+   * buffer pixels, so set a transparent background color with
+   * `setBackgroundColor(COLOR_CLEAR)` when using them. Layers are stacked in
+   * index order, lower indices first, over black.
+   *
+   * The pixels are not copied and must stay valid while the layer is set.
+   * A new layer is visible, unscrolled and fully opaque. Draw into it with
+   * `setDrawLayer()`.
+   */
+  static void setLayer(uint8_t layer, Color pixels[], uint16_t width = WIDTH, uint16_t height = HEIGHT, bool above = false);
+
+  /** \brief
+   * Sets up a compositing layer from a surface.
+   *
+   * \param layer The layer index, from 0 to `DOTMG_LAYER_COUNT` - 1.
+   * \param surface The surface holding the layer's pixels. The surface is
+   * copied, but not its pixels.
+   * \param above If `true`, the layer is shown in front of the frame buffer
+   * (optional; defaults to `false`).
+   *
+   * \details
+   * See the other version of `setLayer()`.
+   */
+  static void setLayer(uint8_t layer, const Surface &surface, bool above = false);
+
+  /** \brief
+   * Show or hide a compositing layer.
+   *
+   * \param layer The layer index.
+   * \param visible `true` to show the layer.
+   */
+  static void setLayerVisible(uint8_t layer, bool visible);
+
+  /** \brief
+   * Scroll a compositing layer.
+   *
+   * \param layer The layer index.
+   * \param x The X coordinate within the layer shown at the left edge of the screen.
+   * \param y The Y coordinate within the layer shown at the top edge of the screen.
+   *
+   * \details
+   * Layers repeat endlessly in both directions, so a layer that is smaller
+   * than the screen is tiled, and scrolling past the edge of a layer wraps
+   * around.
+   */
+  static void setLayerScroll(uint8_t layer, int16_t x, int16_t y);
+
+  /** \brief
+   * Set how opaque a compositing layer is.
+   *
+   * \param layer The layer index.
+   * \param opacity From 0 (invisible) to 255 (as opaque as its pixels).
+   */
+  static void setLayerOpacity(uint8_t layer, uint8_t opacity);
+
+  /** \brief
+   * Direct drawing to a compositing layer, or back to the frame buffer.
+   *
+   * \param layer The layer index, or -1 for the frame buffer.
+   *
+   * \return `false` if the layer isn't set up. Drawing is left unchanged.
+   *
+   * \details
+   * This is the same as calling `setDrawTarget()` with the layer's surface.
+   */
+  static bool setDrawLayer(int8_t layer);
+
+  /** \brief
+   * Direct drawing to a surface, or back to the frame buffer.
+   *
+   * \param surface The surface to draw into, or `NULL` for the frame buffer.
+   * The surface is copied, but not its pixels.
+   *
+   * \details
+   * All drawing functions then draw into the surface, in surface coordinates.
+   * The view stack is reset (see `resetView()`), so the clip rectangle covers
+   * the whole surface. The deferred draw list, `clear()` and `display()`
+   * always use the frame buffer.
+   */
+  static void setDrawTarget(const Surface *surface);
+
+  /** \brief
+   * Get the surface drawing currently goes to.
+   *
+   * \return The current draw target. This is the frame buffer unless
+   * `setDrawTarget()` or `setDrawLayer()` was called.
+   */
+  static Surface drawTarget();
+
+  /** \brief
+   * Draw a surface.
+   *
+   * \param x The X coordinate of the top left pixel affected by the surface.
+   * \param y The Y coordinate of the top left pixel affected by the surface.
+   * \param surface The surface to draw. It must not be the draw target.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   * \param flags Orientation flags (optional; defaults to 0).
+   *
+   * \details
+   * Pixels are drawn the same way as by `drawBitmap()`.
+   */
+  static void drawSurface(int16_t x, int16_t y, const Surface &surface, BlendFunc blend = BLEND_ALPHA, uint8_t flags = 0);
+
+  /** \brief
+   * Copy a surface, ignoring its alpha channel.
+   *
+   * \param x The X coordinate of the top left pixel affected by the surface.
+   * \param y The Y coordinate of the top left pixel affected by the surface.
+   * \param surface The surface to copy. It must not be the draw target.
+   * \param flags Orientation flags (optional; defaults to 0).
+   *
+   * \details
+   * Every visible row of the surface is copied as a whole, which is the
+   * fastest way to draw an opaque surface.
+   */
+  static void copySurface(int16_t x, int16_t y, const Surface &surface, uint8_t flags = 0);
+
+  /** \brief
+   * Restrict drawing to a rectangle, saving the previous view on the view stack.
+   *
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the clip rectangle.
+   * \param h The height of the clip rectangle.
+   *
+   * \return `true` if the view was pushed, `false` if the view stack is full.
+   *
+   * \details
+   * The rectangle is given in the current (possibly translated) coordinates and
+   * is intersected with the active clip rectangle, so a pushed clip can never
+   * enlarge the drawable area. Every drawing function honours the active clip
+   * rectangle. Call `popView()` to restore the previous view.
+   *
+   * The view stack holds `DOTMG_VIEW_STACK_SIZE` entries (8 by default).
+   */
+  static bool pushClipRect(int16_t x, int16_t y, uint16_t w, uint16_t h);
+
+  /** \brief
+   * Move the drawing origin, saving the previous view on the view stack.
+   *
+   * \param dx The horizontal offset to add to the current origin.
+   * \param dy The vertical offset to add to the current origin.
+   *
+   * \return `true` if the view was pushed, `false` if the view stack is full.
+   *
+   * \details
+   * After this call, all drawing functions treat coordinates as relative to
+   * the new origin. The clip rectangle is not changed. Call `popView()` to
+   * restore the previous view.
+   */
+  static bool pushTranslation(int16_t dx, int16_t dy);
+
+  /** \brief
+   * Set up a viewport, saving the previous view on the view stack.
+   *
+   * \param x The X coordinate of the upper left corner of the viewport.
+   * \param y The Y coordinate of the upper left corner of the viewport.
+   * \param w The width of the viewport.
+   * \param h The height of the viewport.
+   *
+   * \return `true` if the view was pushed, `false` if the view stack is full.
+   *
+   * \details
+   * This is equivalent to `pushClipRect()` followed by a translation to the
+   * upper left corner of the rectangle, but uses a single view stack entry.
+   * Drawing at 0, 0 afterwards draws at the top left corner of the viewport.
+   *
+   * example:
+   * \code{.cpp}
+   * // draw the minimap into the lower right corner
+   * dmg.pushViewport(WIDTH - 40, HEIGHT - 32, 40, 32);
+   * drawMinimap();
+   * dmg.popView();
+   * \endcode
+   */
+  static bool pushViewport(int16_t x, int16_t y, uint16_t w, uint16_t h);
+
+  /** \brief
+   * Restore the view that was active before the latest `pushClipRect()`,
+   * `pushTranslation()` or `pushViewport()` call.
+   *
+   * \details
+   * Calling this function with an empty view stack has no effect.
+   */
+  static void popView();
+
+  /** \brief
+   * Empty the view stack, restoring the full screen clip and a zero origin.
+   */
+  static void resetView();
+
+  /** \brief
+   * Get the active clip rectangle.
+   *
+   * \return The active clip rectangle, in the current (translated) coordinates.
    */
-  static uint16_t backgroundImageWidth();
+  static Rect clipRect();
 
   /** \brief
-   * Get the current background image height.
+   * Get the current drawing origin.
    *
-   * \return The current background image height. Returns zero if none is set.
+   * \return The screen coordinates that drawing at 0, 0 currently maps to.
    */
-  static uint16_t backgroundImageHeight();
+  static Point viewOrigin();
 
   /** \brief
-   * Get the current background image blending function.
+   * Test if any part of a rectangle lies within the active clip rectangle.
    *
-   * \return The current background image blending function. Returns `BLEND_ALPHA`
-   * if none is set.
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   *
+   * \return `true` if drawing inside the rectangle could change any pixel.
+   *
+   * \details
+   * This can be used to skip whole objects that are outside of the current
+   * view before doing any work to draw them.
    */
-  static BlendFunc backgroundImageBlendFunc();
+  static bool isVisible(int16_t x, int16_t y, uint16_t w, uint16_t h);
 
   /** \brief
    * Set a single pixel in the frame buffer to the specified color.
@@ -208,7 +1164,9 @@ class DotMGBase : public DotMGCore
    * it represents the result of any previous blending that might have occurred
    * during a `draw*()` function.
    *
-   * If the given coordinate is not on the screen, `COLOR_CLEAR` will be returned.
+   * The coordinates are relative to the current view origin (see
+   * `pushTranslation()`). If the given coordinate is not on the screen,
+   * `COLOR_CLEAR` will be returned. The clip rectangle is not applied.
    */
   static Color getPixel(int16_t x, int16_t y);
 
@@ -299,6 +1257,9 @@ class DotMGBase : public DotMGCore
    *
    * \param color The fill color (optional; defaults to `COLOR_WHITE`).
    * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \details
+   * Only the area inside the active clip rectangle is filled.
    */
   static void fillScreen(Color color = COLOR_WHITE, BlendFunc blend = BLEND_ALPHA);
 
@@ -365,12 +1326,359 @@ class DotMGBase : public DotMGCore
    * \param w The width of the bitmap in pixels.
    * \param h The height of the bitmap in pixels.
    * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   * \param flags Orientation flags (optional; defaults to 0).
    *
    * \details
    * Pixels are arranged in rows, from left to right. Pixels with a zero-valued
    * alpha channel will not be drawn.
+   *
+   * When blending with `BLEND_ALPHA` or `BLEND_NONE`, runs of fully opaque
+   * pixels are copied straight into the frame buffer and runs of transparent
+   * pixels are skipped, so bitmaps whose alpha is only ever 0 or 15 draw
+   * fastest.
+   *
+   * The bitmap can be mirrored or rotated by combining these flags:
+   *
+   * - `BITMAP_ROTATE_90` rotates the bitmap 90 degrees clockwise. The rotated
+   *   bitmap is `h` pixels wide and `w` pixels high.
+   * - `BITMAP_FLIP_X` mirrors the (rotated) bitmap horizontally.
+   * - `BITMAP_FLIP_Y` mirrors the (rotated) bitmap vertically.
+   *
+   * `BITMAP_ROTATE_180` and `BITMAP_ROTATE_270` are provided as shorthands.
+   * In all cases `x` and `y` give the top left corner of the drawn bitmap.
+   * Flipped and rotated bitmaps are clipped and drawn the same way, and just
+   * as fast, as unflipped ones.
+   */
+  static void drawBitmap(int16_t x, int16_t y, const Color bitmap[], uint16_t w, uint16_t h, BlendFunc blend = BLEND_ALPHA, uint8_t flags = 0);
+
+  /** \brief
+   * Draw a bitmap transformed by a matrix, e.g. scaled and/or rotated.
+   *
+   * \param bitmap A pointer to the bitmap array in program memory.
+   * \param w The width of the bitmap in pixels.
+   * \param h The height of the bitmap in pixels.
+   * \param matrix The matrix mapping bitmap coordinates to screen coordinates.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \details
+   * The screen area covered by the transformed bitmap is found and clipped
+   * first. For each row in it, the part of the row that lands inside the
+   * bitmap is worked out up front, and the bitmap is then sampled (nearest
+   * pixel) by stepping through it in fixed point, with no per-pixel bounds
+   * checks. Pixels with a zero-valued alpha channel are not drawn.
+   */
+  static void drawBitmapAffine(const Color bitmap[], uint16_t w, uint16_t h, const AffineMatrix &matrix, BlendFunc blend = BLEND_ALPHA);
+
+  /** \brief
+   * Draw rows of a bitmap with a separate position and step for every row,
+   * e.g. for "Mode 7" style perspective floors.
+   *
+   * \param bitmap A pointer to the bitmap array in program memory.
+   * \param w The width of the bitmap in pixels.
+   * \param h The height of the bitmap in pixels.
+   * \param y The Y coordinate of the first row to draw.
+   * \param rows The number of rows to draw.
+   * \param scanline Called for every visible row to set up its source position and step.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   * \param wrap If `true`, the bitmap repeats endlessly. Otherwise, pixels
+   * outside the bitmap are left untouched (optional; defaults to `true`).
+   *
+   * \details
+   * Each row spans the whole width of the clip rectangle. Wrapping is fastest
+   * when `w` and `h` are powers of two.
+   */
+  static void drawBitmapScanlines(const Color bitmap[], uint16_t w, uint16_t h, int16_t y, uint16_t rows, AffineScanlineFunc scanline, BlendFunc blend = BLEND_ALPHA, bool wrap = true);
+
+  /** \brief
+   * Draw a frame from a sprite atlas.
+   *
+   * \param atlas The sprite atlas.
+   * \param index The index of the frame in the atlas frame table.
+   * \param x The X coordinate the frame's pivot is drawn at.
+   * \param y The Y coordinate the frame's pivot is drawn at.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   * \param flags Orientation flags (optional; defaults to 0).
+   *
+   * \details
+   * Only the trimmed pixels of the frame are visited; the transparent
+   * borders removed when the atlas was built cost nothing. Pixels are drawn
+   * the same way as by `drawBitmap()`.
+   *
+   * The orientation flags (see `drawBitmap()`) apply to the whole untrimmed
+   * frame, including its pivot, so the pivot still lands at `x`, `y`.
+   */
+  static void drawFrame(const SpriteAtlas &atlas, uint16_t index, int16_t x, int16_t y, BlendFunc blend = BLEND_ALPHA, uint8_t flags = 0);
+
+  /** \brief
+   * Get the area covered by the trimmed pixels of a sprite atlas frame.
+   *
+   * \param atlas The sprite atlas.
+   * \param index The index of the frame in the atlas frame table.
+   * \param x The X coordinate the frame's pivot would be drawn at.
+   * \param y The Y coordinate the frame's pivot would be drawn at.
+   * \param flags Orientation flags (optional; defaults to 0).
+   *
+   * \return The rectangle that `drawFrame()` would draw in, given the same
+   * arguments.
+   */
+  static Rect frameBounds(const SpriteAtlas &atlas, uint16_t index, int16_t x, int16_t y, uint8_t flags = 0);
+
+  /** \brief
+   * Draw a run-length encoded sprite from program memory.
+   *
+   * \param x The X coordinate of the top left pixel affected by the sprite.
+   * \param y The Y coordinate of the top left pixel affected by the sprite.
+   * \param sprite A pointer to the sprite data in program memory.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   * \param flags Orientation flags (optional; defaults to 0). See `drawBitmap()`.
+   *
+   * \details
+   * Sprites are usually created by `extras/img2dotmg.py` with the `--rle`
+   * option. The data is an array of 16-bit words:
+   *
+   * - Word 0 is the width and word 1 is the height of the sprite in pixels.
+   * - The next `height + 1` words are offsets, counted in words from the start
+   *   of the array, of the runs making up each row. Row `r` uses the words from
+   *   offset `r` up to (but not including) offset `r + 1`.
+   * - Each run starts with a word combining a run type (`SPRITE_RUN_SKIP`,
+   *   `SPRITE_RUN_OPAQUE` or `SPRITE_RUN_TRANSLUCENT`) with a pixel count
+   *   (up to `SPRITE_RUN_LENGTH_MASK`). Skip runs cover transparent pixels and
+   *   have no pixel data. The other runs are followed by one `Color` per pixel.
+   * - Transparent pixels at the end of a row don't need a run.
+   *
+   * Transparent pixels are skipped a whole run at a time and, when blending
+   * with `BLEND_ALPHA` or `BLEND_NONE`, opaque runs are copied straight into
+   * the frame buffer. Only the rows and runs inside the clip rectangle are
+   * visited.
+   */
+  static void drawSprite(int16_t x, int16_t y, const uint16_t sprite[], BlendFunc blend = BLEND_ALPHA, uint8_t flags = 0);
+
+  /** \brief
+   * Get the width of a run-length encoded sprite.
+   *
+   * \param sprite A pointer to the sprite data in program memory.
+   */
+  static uint16_t spriteWidth(const uint16_t sprite[]);
+
+  /** \brief
+   * Get the height of a run-length encoded sprite.
+   *
+   * \param sprite A pointer to the sprite data in program memory.
+   */
+  static uint16_t spriteHeight(const uint16_t sprite[]);
+
+  /** \brief
+   * Draw the part of a tile map seen by a camera.
+   *
+   * \param map The tile map.
+   * \param cameraX The X coordinate within the map, in pixels, drawn at X coordinate 0.
+   * \param cameraY The Y coordinate within the map, in pixels, drawn at Y coordinate 0.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \details
+   * The map fills the clip rectangle (see `pushClipRect()`), and only the
+   * tiles inside it are visited. With `BLEND_ALPHA` or `BLEND_NONE`, tiles
+   * flagged `TILE_OPAQUE` are copied row by row, and tiles flagged
+   * `TILE_EMPTY` are skipped. Other tiles are drawn like `drawBitmap()`.
+   *
+   * Animated tiles advance with `frameCount()`.
+   *
+   * example:
+   * \code{.cpp}
+   * // keep the player in the middle of the screen
+   * dmg.drawTileMap(level, playerX - WIDTH/2, playerY - HEIGHT/2);
+   * \endcode
+   */
+  static void drawTileMap(const TileMap &map, int16_t cameraX, int16_t cameraY, BlendFunc blend = BLEND_ALPHA);
+
+  /** \brief
+   * Get the tile index a map cell currently shows.
+   *
+   * \param map The tile map.
+   * \param cell The contents of the map cell.
+   *
+   * \return The index of the tile in the tileset, with animations applied and
+   * the orientation bits removed.
+   */
+  static uint16_t tileIndex(const TileMap &map, uint16_t cell);
+
+  /** \brief
+   * Add a filled-in rectangle to the deferred draw list.
+   *
+   * \param layer The layer to draw in. Lower layers are drawn first.
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   * \param color The color of the rectangle (optional; defaults to `COLOR_WHITE`).
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \return `true` if the command was queued, `false` if the draw list is full.
+   *
+   * \details
+   * Instead of being drawn right away, the rectangle is drawn when the draw
+   * list is flushed by `display()` or `flushDrawList()`. An opaque rectangle
+   * hides the commands beneath it in lower layers, which are then skipped for
+   * the parts of the screen it covers.
+   */
+  static bool queueFillRect(uint8_t layer, int16_t x, int16_t y, uint16_t w, uint16_t h, Color color = COLOR_WHITE, BlendFunc blend = BLEND_ALPHA);
+
+  /** \brief
+   * Add a rectangle outline to the deferred draw list.
+   *
+   * \param layer The layer to draw in. Lower layers are drawn first.
+   * \param x The X coordinate of the upper left corner.
+   * \param y The Y coordinate of the upper left corner.
+   * \param w The width of the rectangle.
+   * \param h The height of the rectangle.
+   * \param color The color of the rectangle (optional; defaults to `COLOR_WHITE`).
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \return `true` if the command was queued, `false` if the draw list is full.
+   *
+   * \details
+   * See `queueFillRect()` and `drawRect()`.
+   */
+  static bool queueRect(uint8_t layer, int16_t x, int16_t y, uint16_t w, uint16_t h, Color color = COLOR_WHITE, BlendFunc blend = BLEND_ALPHA);
+
+  /** \brief
+   * Add a line to the deferred draw list.
+   *
+   * \param layer The layer to draw in. Lower layers are drawn first.
+   * \param x0,x1 The X coordinates of the line ends.
+   * \param y0,y1 The Y coordinates of the line ends.
+   * \param color The line's color (optional; defaults to `COLOR_WHITE`).
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \return `true` if the command was queued, `false` if the draw list is full.
+   *
+   * \details
+   * See `queueFillRect()` and `drawLine()`.
+   */
+  static bool queueLine(uint8_t layer, int16_t x0, int16_t y0, int16_t x1, int16_t y1, Color color = COLOR_WHITE, BlendFunc blend = BLEND_ALPHA);
+
+  /** \brief
+   * Add a bitmap to the deferred draw list.
+   *
+   * \param layer The layer to draw in. Lower layers are drawn first.
+   * \param x The X coordinate of the top left pixel affected by the bitmap.
+   * \param y The Y coordinate of the top left pixel affected by the bitmap.
+   * \param bitmap A pointer to the bitmap array in program memory.
+   * \param w The width of the bitmap in pixels.
+   * \param h The height of the bitmap in pixels.
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   * \param flags Orientation flags (optional; defaults to 0). See `drawBitmap()`.
+   *
+   * \return `true` if the command was queued, `false` if the draw list is full.
+   *
+   * \details
+   * The bitmap is not copied, so it must remain valid until the draw list is
+   * flushed. See `queueFillRect()` and `drawBitmap()`.
+   */
+  static bool queueBitmap(uint8_t layer, int16_t x, int16_t y, const Color bitmap[], uint16_t w, uint16_t h, BlendFunc blend = BLEND_ALPHA, uint8_t flags = 0);
+
+  /** \brief
+   * Add a custom command to the deferred draw list.
+   *
+   * \param command The command to add. It is copied into the draw list.
+   *
+   * \return `true` if the command was queued, `false` if the draw list is full.
+   *
+   * \details
+   * The command's coordinates and its `left`, `top`, `right` and `bottom`
+   * bounds are converted from the active view to screen coordinates, and the
+   * bounds are clipped to the active clip rectangle. The bounds must enclose
+   * every pixel the command draws. Commands that end up completely clipped
+   * are dropped, and `true` is returned.
+   */
+  static bool queueCommand(const DrawCommand &command);
+
+  /** \brief
+   * Render and empty the deferred draw list.
+   *
+   * \details
+   * The screen is split into `DOTMG_DRAW_TILE_SIZE` square tiles and the
+   * commands are binned into the tiles they touch. Each tile is then rendered
+   * completely before moving on to the next one, drawing its commands from the
+   * lowest layer to the highest (in the order they were queued within a layer),
+   * and skipping all commands beneath the topmost opaque command that covers
+   * the whole tile. Lines only step through the part inside each tile, and
+   * text stops at the first character past it.
+   *
+   * This is called by `display()`, so it's only needed when immediate drawing
+   * must happen on top of queued commands.
+   */
+  static void flushDrawList();
+
+  /** \brief
+   * Get the number of commands waiting in the deferred draw list.
+   */
+  static uint16_t drawListLength();
+
+  /** \brief
+   * Add a sprite to the sprite pool.
+   *
+   * \param atlas The sprite atlas to take frames from.
+   * \param frame The index of the frame in the atlas.
+   * \param x The X coordinate the frame's pivot is drawn at.
+   * \param y The Y coordinate the frame's pivot is drawn at.
+   * \param layer The layer. Sprites in higher layers are drawn on top (optional; defaults to 0).
+   * \param flags Orientation flags and/or `SPRITE_HIDDEN` (optional; defaults to 0).
+   * \param blend Blending function to use (optional; defaults to `BLEND_ALPHA`).
+   *
+   * \return The ID of the new sprite, or -1 if the pool is full.
+   *
+   * \details
+   * The pool holds up to `DOTMG_SPRITE_CAPACITY` sprites. It is a fixed
+   * array; no memory is allocated. The atlas is not copied and must stay
+   * valid while the sprite exists.
    */
-  static void drawBitmap(int16_t x, int16_t y, const Color bitmap[], uint16_t w, uint16_t h, BlendFunc blend = BLEND_ALPHA);
+  static int16_t addSprite(const SpriteAtlas &atlas, uint16_t frame, int16_t x, int16_t y, uint8_t layer = 0, uint8_t flags = 0, BlendFunc blend = BLEND_ALPHA);
+
+  /** \brief
+   * Remove a sprite from the sprite pool.
+   *
+   * \param id The ID returned by `addSprite()`. The ID may be reused by
+   * later sprites.
+   */
+  static void removeSprite(int16_t id);
+
+  /** \brief
+   * Remove all sprites from the sprite pool.
+   */
+  static void clearSprites();
+
+  /** \brief
+   * Get a sprite in the sprite pool, to change it.
+   *
+   * \param id The ID returned by `addSprite()`.
+   *
+   * \return A pointer to the sprite, or `NULL` if there is no sprite with this ID.
+   */
+  static Sprite* getSprite(int16_t id);
+
+  /** \brief
+   * Get the number of sprites in the sprite pool.
+   */
+  static uint16_t spriteCount();
+
+  /** \brief
+   * Draw all sprites in the sprite pool.
+   *
+   * \return The number of sprites drawn.
+   *
+   * \details
+   * Sprites are drawn in layer order, lowest first. Within a layer, the order
+   * is stable from frame to frame: a new sprite starts out on top of the
+   * others in its layer, and a sprite that changes layer keeps its previous
+   * position relative to the sprites around it, so it isn't necessarily on
+   * top of its new layer. The order is only fixed up for sprites that changed
+   * layer, so sorting is nearly free when layers rarely change.
+   *
+   * Hidden sprites and sprites outside the clip rectangle are skipped before
+   * any pixels are touched. The others are drawn like `drawFrame()`.
+   */
+  static uint16_t drawSprites();
 
   /** \brief
    * Get a pointer to the current frame buffer in RAM.
@@ -721,6 +2029,9 @@ class DotMGBase : public DotMGCore
    * This function is intended to detemine if an object, whose boundaries are
    * are defined by the given rectangle, is in contact with another rectangular
    * object.
+   *
+   * To find collisions among many objects, see `CollisionGrid` in
+   * Collision.h.
    */
   static bool collide(Rect rect1, Rect rect2);
 };
@@ -816,6 +2127,9 @@ class DotMG : public Print, public DotMGBase
    * coordinate. The point specified by the X and Y coordinates will be the
    * top left corner of the character.
    *
+   * Each row of the character is drawn as a few horizontal runs, so larger
+   * sizes cost about the same as size 1.
+   *
    * \note
    * This is a low level function used by the `write()` function to draw a
    * character. Although it's available as a public function, it wouldn't
@@ -824,6 +2138,206 @@ class DotMG : public Print, public DotMGBase
    */
   static void drawChar(int16_t x, int16_t y, unsigned char c, Color color = COLOR_WHITE, Color bg = COLOR_CLEAR, uint8_t size = 1, BlendFunc textBlend = BLEND_ALPHA, BlendFunc bgBlend = BLEND_ALPHA);
 
+  /** \brief
+   * Draw a string at the specified location.
+   *
+   * \param x The X coordinate, in pixels, of the top left corner of the text.
+   * \param y The Y coordinate, in pixels, of the top left corner of the text.
+   * \param text The null-terminated text to draw.
+   *
+   * \details
+   * The text is drawn with the current text color, background, size and
+   * blending functions. Newline characters start a new line at the given X
+   * coordinate. The text cursor is not used or moved, and wrap mode does not
+   * apply.
+   *
+   * This is faster than printing the text: there is no call per character
+   * through `Print`, and lines outside the clip rectangle are skipped whole.
+   */
+  static void drawString(int16_t x, int16_t y, const char *text);
+
+  /** \brief
+   * Draw an integer at the specified location.
+   *
+   * \param x The X coordinate, in pixels, of the top left corner of the number.
+   * \param y The Y coordinate, in pixels, of the top left corner of the number.
+   * \param value The number to draw.
+   * \param width The least number of characters to draw, including the minus
+   * sign (optional; defaults to 0). Shorter numbers are padded on the left.
+   * \param zeroPad `true` to pad with zeros after any minus sign, `false` to
+   * pad with spaces (optional; defaults to `false`).
+   *
+   * \details
+   * The number is drawn like `drawString()`. Padding to a width keeps a
+   * number right aligned as it changes, as long as the font's digits and
+   * space have the same advance, as in the built-in font.
+   *
+   * This is much faster than printing the number: digits are converted two
+   * at a time from a table, and the result is drawn in one go.
+   */
+  static void drawNumber(int16_t x, int16_t y, int32_t value, uint8_t width = 0, bool zeroPad = false);
+
+  /** \brief
+   * Draw a fixed point number at the specified location.
+   *
+   * \param x The X coordinate, in pixels, of the top left corner of the number.
+   * \param y The Y coordinate, in pixels, of the top left corner of the number.
+   * \param value The number to draw, with `fractionBits` fraction bits.
+   * \param fractionBits The number of fraction bits in `value`, up to 16. For
+   * example, 8 for an 8.8 number or 16 for a 16.16 number.
+   * \param decimals The number of digits after the decimal point, up to 4.
+   * \param width The least number of characters to draw, including the minus
+   * sign and decimal point (optional; defaults to 0).
+   * \param zeroPad `true` to pad with zeros after any minus sign, `false` to
+   * pad with spaces (optional; defaults to `false`).
+   *
+   * \details
+   * The number is rounded to the given number of decimals, and drawn like
+   * `drawNumber()`. For example, `drawFixed(0, 0, 0x18000, 16, 2)` draws
+   * "1.50".
+   */
+  static void drawFixed(int16_t x, int16_t y, int32_t value, uint8_t fractionBits, uint8_t decimals, uint8_t width = 0, bool zeroPad = false);
+
+  /** \brief
+   * Add text to the deferred draw list.
+   *
+   * \param layer The layer to draw in. Lower layers are drawn first.
+   * \param x The X coordinate, in pixels, of the top left corner of the text.
+   * \param y The Y coordinate, in pixels, of the top left corner of the text.
+   * \param text The null-terminated text to draw.
+   *
+   * \return `true` if the command was queued, `false` if the draw list is full.
+   *
+   * \details
+   * The text is drawn with the current text color, background, size and
+   * blending functions. Newline characters start a new line at the given X
+   * coordinate. The text cursor is not used or moved, and wrap mode does not
+   * apply.
+   *
+   * The text is not copied, so it must remain valid until the draw list is
+   * flushed. See `DotMGBase::queueFillRect()`.
+   */
+  static bool queueText(uint8_t layer, int16_t x, int16_t y, const char *text);
+
+  /** \brief
+   * Find the size of text without drawing it.
+   *
+   * \param text The null-terminated text to measure.
+   *
+   * \return A rectangle at 0, 0 with the width of the widest line and the
+   * height of all lines.
+   *
+   * \details
+   * The text is measured as `drawString()` would draw it, with the current
+   * font and text size. Newline characters start a new line. For example, to
+   * center text on the screen:
+   *
+   * \code{.cpp}
+   * Rect r = dmg.measureText(title);
+   * dmg.drawString((WIDTH - r.width) / 2, (HEIGHT - r.height) / 2, title);
+   * \endcode
+   */
+  static Rect measureText(const char *text);
+
+  /** \brief
+   * Break text into lines that fit a width, without drawing it.
+   *
+   * \param text The null-terminated text to lay out.
+   * \param width The width, in pixels, that lines must fit in.
+   * \param align `TEXT_ALIGN_LEFT`, `TEXT_ALIGN_CENTER` or `TEXT_ALIGN_RIGHT`.
+   * \param lines The array that receives the lines.
+   * \param maxLines The number of elements in `lines`.
+   *
+   * \return The number of lines stored in `lines`.
+   *
+   * \details
+   * Lines are broken at spaces, or within a word that is wider than `width`
+   * on its own, and at newline characters. Spaces at a break or at the end
+   * of a line are dropped.
+   * Each line's `x` is its offset within `width` for the alignment, and its
+   * `y` is its offset from the top of the first line. Layout uses the current
+   * font and text size.
+   *
+   * Layout stops when `lines` is full. The text after the last line then
+   * starts at `lines[maxLines - 1].text + lines[maxLines - 1].length`, which
+   * can be used to lay out the next page of a dialogue. It may begin with the
+   * spaces of the last break.
+   *
+   * The lines only refer to `text`, so laying out static text once and
+   * drawing the lines every frame with `drawTextLines()` avoids measuring it
+   * again.
+   */
+  static uint8_t layoutText(const char *text, int16_t width, uint8_t align, TextLine *lines, uint8_t maxLines);
+
+  /** \brief
+   * Draw lines laid out by `layoutText()`.
+   *
+   * \param x The X coordinate, in pixels, of the left of the layout width.
+   * \param y The Y coordinate, in pixels, of the top of the first line.
+   * \param lines The lines to draw.
+   * \param count The number of lines.
+   *
+   * \details
+   * The lines are drawn with the current text color, background, size and
+   * blending functions, which should use the same font and size as the
+   * layout. The text cursor is not used or moved.
+   */
+  static void drawTextLines(int16_t x, int16_t y, const TextLine *lines, uint8_t count);
+
+  /** \brief
+   * Draw text through a cache that keeps its pixels between frames.
+   *
+   * \param x The X coordinate, in pixels, of the top left corner of the text.
+   * \param y The Y coordinate, in pixels, of the top left corner of the text.
+   * \param cache The cache for this piece of text.
+   * \param text The null-terminated text to draw.
+   *
+   * \details
+   * The text is rendered into the cache with the current font, text color,
+   * background, size and blending functions, and only drawn again from the
+   * cache while none of these change. Drawing from the cache costs about as
+   * much as drawing a bitmap of the same size, with opaque runs copied whole.
+   *
+   * When single line text changes, only the characters from the first change
+   * onwards are rendered again, so a counter whose last digits change every
+   * frame doesn't redraw the rest.
+   *
+   * The result matches `drawString()`, except where translucent glyphs
+   * without a background overlap each other (with negative kerning, for
+   * example). A background is cached along with the text only when it is
+   * opaque and drawn with `BLEND_ALPHA` or `BLEND_NONE`, and so is the text.
+   * Otherwise the finished pixels would depend on what's beneath, so the
+   * text is drawn with `drawString()` instead, as is text that is too long
+   * or too large for the cache.
+   */
+  static void drawCachedText(int16_t x, int16_t y, TextCache &cache, const char *text);
+
+  /** \brief
+   * Set the font for following text.
+   *
+   * \param font A proportional font, or `NULL` for the built-in 6x8 font.
+   *
+   * \details
+   * The font is used by `write()` (and thus `print()`), `drawString()`,
+   * `queueText()` and the text measuring and layout functions. Each character
+   * then moves the cursor by its own advance, adjusted by the font's kerning
+   * pairs, and lines are the font's line height apart. The text size scales
+   * all of these.
+   *
+   * With a text background color, the background fills each character's
+   * advance by the line height.
+   *
+   * The font is not copied and must stay valid while it is set.
+   */
+  static void setFont(const Font *font);
+
+  /** \brief
+   * Get the current font.
+   *
+   * \return The font set by `setFont()`, or `NULL` for the built-in font.
+   */
+  static const Font* getFont();
+
   /** \brief
    * Set the location of the text cursor.
    *
@@ -17,9 +17,20 @@
 #define TIMER_IRQ2     TC2_IRQn
 #define TIMER2_HANDLER void TC2_Handler()
 
+// Backlight fade timer
+#define TIMER3         TC3
+#define TIMER_GCLK_ID3 TC3_GCLK_ID
+#define TIMER_IRQ3     TC3_IRQn
+#define TIMER3_HANDLER void TC3_Handler()
+#define BACKLIGHT_TICK 1000  // Hz
+
 static uint8_t MADCTL = ST77XX_MADCTL_MV | ST77XX_MADCTL_MY;
 static bool inverted = false;
 
+static void writeBacklightPin(uint8_t level);
+static void enableBacklight(bool on);
+static Backlight backlightState(writeBacklightPin);
+
 static const uint16_t stageLen = DISP_WIDTH*DISP_HEIGHT*12/8; // 12 bits/px, 8 bits/byte
 static uint8_t buf1[stageLen];
 static uint8_t buf2[stageLen];
@@ -49,6 +60,8 @@ static void beginDisplaySPI();
 static void setWriteRegion();
 
 static void timer_init(Tc *TCx, unsigned int clkId, IRQn_Type irqn);
+static void timer_start(Tc *TCx, uint32_t freq);
+static void timer_stop(Tc *TCx);
 static void toggle(uint8_t chan) __attribute__((always_inline));
 
 
@@ -77,6 +90,7 @@ void bootDisplay()
 {
   pinMode(PIN_DISP_DC, OUTPUT);
   pinMode(PIN_DISP_LED, OUTPUT);
+  timer_init(TIMER3, TIMER_GCLK_ID3, TIMER_IRQ3);
 
   // Activate display SPI slave
   pinMode(PIN_SPI_DISP_SS, OUTPUT);
@@ -226,7 +240,7 @@ void DotMGCore::allPixelsOn(bool on)
 
 void DotMGCore::displayOff()
 {
-  *portOutputRegister(PORT_DISP_DC_LED) &= ~MASK_DISP_LED;
+  enableBacklight(false);
   beginDisplaySPI();
   sendDisplayCommand(ST77XX_SLPIN);
   delay(150);
@@ -237,7 +251,47 @@ void DotMGCore::displayOn()
   beginDisplaySPI();
   sendDisplayCommand(ST77XX_SLPOUT);
   delay(150);
-  *portOutputRegister(PORT_DISP_DC_LED) |= MASK_DISP_LED;
+  enableBacklight(true);
+}
+
+void writeBacklightPin(uint8_t level)
+{
+  analogWrite(PIN_DISP_LED, level);
+}
+
+void enableBacklight(bool on)
+{
+  // Keep the fade timer out while the output changes
+  timer_stop(TIMER3);
+  backlightState.enable(on);
+
+  if (backlightState.fading())
+    timer_start(TIMER3, BACKLIGHT_TICK);
+}
+
+void DotMGCore::setBacklight(uint8_t level)
+{
+  timer_stop(TIMER3);
+  backlightState.set(level);
+}
+
+void DotMGCore::fadeBacklight(uint8_t level, uint16_t duration)
+{
+  timer_stop(TIMER3);
+  backlightState.fade(level, duration, millis());
+
+  if (backlightState.fading())
+    timer_start(TIMER3, BACKLIGHT_TICK);
+}
+
+uint8_t DotMGCore::backlight()
+{
+  return backlightState.level();
+}
+
+bool DotMGCore::backlightFading()
+{
+  return backlightState.fading();
 }
 
 uint8_t DotMGCore::buttonsState()
@@ -345,7 +399,17 @@ static void timer_tone(Tc *TCx, float freq)
   while (TCx->COUNT16.SYNCBUSY.bit.ENABLE);
 }
 
-static void timer_stop(Tc *TCx)
+void timer_start(Tc *TCx, uint32_t freq)
+{
+  // Set counter to overflow freq times per second
+  TCx->COUNT16.CC[0].reg = (uint16_t)(F_CPU / 64 / freq - 1);
+
+  // Enable counter
+  TCx->COUNT16.CTRLA.bit.ENABLE = 1;
+  while (TCx->COUNT16.SYNCBUSY.bit.ENABLE);
+}
+
+void timer_stop(Tc *TCx)
 {
   // Disable counter
   TCx->COUNT16.CTRLA.bit.ENABLE = 0;
@@ -434,3 +498,13 @@ TIMER2_HANDLER
   toggle(TONE_CH2);
   TIMER2->COUNT16.INTFLAG.bit.MC0 = 1;  // Clear interrupt
 }
+
+TIMER3_HANDLER
+{
+  backlightState.update(millis());
+
+  if (!backlightState.fading())
+    timer_stop(TIMER3);
+
+  TIMER3->COUNT16.INTFLAG.bit.MC0 = 1;  // Clear interrupt
+}
@@ -8,6 +8,7 @@
 #define DOTMG_CORE_H
 
 #include <Arduino.h>
+#include "Backlight.h"
 
 // ----- Helpful values/macros -----
 
@@ -63,7 +64,6 @@
 #define PORT_DISP_DC_LED    (&(PORT->Group[PORTA]))
 
 #define MASK_DISP_DC        digitalPinToBitMask(PIN_DISP_DC)
-#define MASK_DISP_LED       digitalPinToBitMask(PIN_DISP_LED)
 #define MASK_SPI_MOSI       digitalPinToBitMask(PIN_SPI_DISP_MOSI)
 #define MASK_SPI_SCK        digitalPinToBitMask(PIN_SPI_DISP_SCK)
 
@@ -260,6 +260,47 @@ class DotMGCore
      */
     static void displayOn();
 
+    /** \brief
+     * Set the backlight brightness.
+     *
+     * \param level From 0 (off) to `BACKLIGHT_MAX` (full brightness, the default).
+     *
+     * \details
+     * The backlight is dimmed by PWM, so dark levels save battery power,
+     * e.g. in menus. Any fade started with `fadeBacklight()` is stopped.
+     *
+     * While the display is off (see `displayOff()`), the level is kept and
+     * used when the display is turned back on.
+     */
+    static void setBacklight(uint8_t level);
+
+    /** \brief
+     * Fade the backlight brightness to a level over time.
+     *
+     * \param level The brightness to end at (see `setBacklight()`).
+     * \param duration The length of the fade in milliseconds.
+     *
+     * \details
+     * The fade is driven by a timer interrupt, so it keeps going while the
+     * sketch waits, sleeps or stops drawing. This fades the whole screen
+     * without touching any pixels.
+     */
+    static void fadeBacklight(uint8_t level, uint16_t duration);
+
+    /** \brief
+     * Get the backlight brightness.
+     *
+     * \return The current brightness, part way through any fade.
+     */
+    static uint8_t backlight();
+
+    /** \brief
+     * Get whether a backlight fade is in progress.
+     *
+     * \return `true` until the level passed to `fadeBacklight()` is reached.
+     */
+    static bool backlightFading();
+
     /** \brief
      * Get the current state of all buttons as a bitmask.
      *
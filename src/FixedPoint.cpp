@@ -0,0 +1,242 @@
+/**
+ * @file FixedPoint.cpp
+ * \brief
+ * Fixed point numbers, vectors, and trigonometry without floating point.
+ */
+
+#include "FixedPoint.h"
+
+// Generated by extras/fixedtables.py:
+// sineTable[i] is the sine of i/256 of a quarter turn, in 16.16 fixed point.
+// atanTable[i] is the arctangent of i/256 as an Angle.
+
+static const uint16_t sineTable[256] = {
+  0x0000, 0x0192, 0x0324, 0x04B6, 0x0648, 0x07DA, 0x096C, 0x0AFE,
+  0x0C90, 0x0E21, 0x0FB3, 0x1144, 0x12D5, 0x1466, 0x15F7, 0x1787,
+  0x1918, 0x1AA8, 0x1C38, 0x1DC7, 0x1F56, 0x20E5, 0x2274, 0x2402,
+  0x2590, 0x271E, 0x28AB, 0x2A38, 0x2BC4, 0x2D50, 0x2EDC, 0x3067,
+  0x31F1, 0x337C, 0x3505, 0x368E, 0x3817, 0x399F, 0x3B27, 0x3CAE,
+  0x3E34, 0x3FBA, 0x413F, 0x42C3, 0x4447, 0x45CB, 0x474D, 0x48CF,
+  0x4A50, 0x4BD1, 0x4D50, 0x4ECF, 0x504D, 0x51CB, 0x5348, 0x54C3,
+  0x563E, 0x57B9, 0x5932, 0x5AAA, 0x5C22, 0x5D99, 0x5F0F, 0x6084,
+  0x61F8, 0x636B, 0x64DD, 0x664E, 0x67BE, 0x692D, 0x6A9B, 0x6C08,
+  0x6D74, 0x6EDF, 0x7049, 0x71B2, 0x731A, 0x7480, 0x75E6, 0x774A,
+  0x78AD, 0x7A10, 0x7B70, 0x7CD0, 0x7E2F, 0x7F8C, 0x80E8, 0x8243,
+  0x839C, 0x84F5, 0x864C, 0x87A1, 0x88F6, 0x8A49, 0x8B9A, 0x8CEB,
+  0x8E3A, 0x8F88, 0x90D4, 0x921F, 0x9368, 0x94B0, 0x95F7, 0x973C,
+  0x9880, 0x99C2, 0x9B03, 0x9C42, 0x9D80, 0x9EBC, 0x9FF7, 0xA130,
+  0xA268, 0xA39E, 0xA4D2, 0xA605, 0xA736, 0xA866, 0xA994, 0xAAC1,
+  0xABEB, 0xAD14, 0xAE3C, 0xAF62, 0xB086, 0xB1A8, 0xB2C9, 0xB3E8,
+  0xB505, 0xB620, 0xB73A, 0xB852, 0xB968, 0xBA7D, 0xBB8F, 0xBCA0,
+  0xBDAF, 0xBEBC, 0xBFC7, 0xC0D1, 0xC1D8, 0xC2DE, 0xC3E2, 0xC4E4,
+  0xC5E4, 0xC6E2, 0xC7DE, 0xC8D9, 0xC9D1, 0xCAC7, 0xCBBC, 0xCCAE,
+  0xCD9F, 0xCE8E, 0xCF7A, 0xD065, 0xD14D, 0xD234, 0xD318, 0xD3FB,
+  0xD4DB, 0xD5BA, 0xD696, 0xD770, 0xD848, 0xD91E, 0xD9F2, 0xDAC4,
+  0xDB94, 0xDC62, 0xDD2D, 0xDDF7, 0xDEBE, 0xDF83, 0xE046, 0xE107,
+  0xE1C6, 0xE282, 0xE33C, 0xE3F4, 0xE4AA, 0xE55E, 0xE610, 0xE6BF,
+  0xE76C, 0xE817, 0xE8BF, 0xE966, 0xEA0A, 0xEAAB, 0xEB4B, 0xEBE8,
+  0xEC83, 0xED1C, 0xEDB3, 0xEE47, 0xEED9, 0xEF68, 0xEFF5, 0xF080,
+  0xF109, 0xF18F, 0xF213, 0xF295, 0xF314, 0xF391, 0xF40C, 0xF484,
+  0xF4FA, 0xF56E, 0xF5DF, 0xF64E, 0xF6BA, 0xF724, 0xF78C, 0xF7F1,
+  0xF854, 0xF8B4, 0xF913, 0xF96E, 0xF9C8, 0xFA1F, 0xFA73, 0xFAC5,
+  0xFB15, 0xFB62, 0xFBAD, 0xFBF5, 0xFC3B, 0xFC7F, 0xFCC0, 0xFCFE,
+  0xFD3B, 0xFD74, 0xFDAC, 0xFDE1, 0xFE13, 0xFE43, 0xFE71, 0xFE9C,
+  0xFEC4, 0xFEEB, 0xFF0E, 0xFF30, 0xFF4E, 0xFF6B, 0xFF85, 0xFF9C,
+  0xFFB1, 0xFFC4, 0xFFD4, 0xFFE1, 0xFFEC, 0xFFF5, 0xFFFB, 0xFFFF,
+};
+
+static const uint16_t atanTable[257] = {
+  0x0000, 0x0029, 0x0051, 0x007A, 0x00A3, 0x00CC, 0x00F4, 0x011D,
+  0x0146, 0x016F, 0x0197, 0x01C0, 0x01E9, 0x0211, 0x023A, 0x0262,
+  0x028B, 0x02B4, 0x02DC, 0x0305, 0x032D, 0x0356, 0x037E, 0x03A7,
+  0x03CF, 0x03F7, 0x0420, 0x0448, 0x0470, 0x0499, 0x04C1, 0x04E9,
+  0x0511, 0x0539, 0x0561, 0x0589, 0x05B1, 0x05D9, 0x0601, 0x0629,
+  0x0651, 0x0678, 0x06A0, 0x06C8, 0x06EF, 0x0717, 0x073E, 0x0766,
+  0x078D, 0x07B5, 0x07DC, 0x0803, 0x082A, 0x0851, 0x0878, 0x089F,
+  0x08C6, 0x08ED, 0x0914, 0x093B, 0x0961, 0x0988, 0x09AE, 0x09D5,
+  0x09FB, 0x0A22, 0x0A48, 0x0A6E, 0x0A94, 0x0ABA, 0x0AE0, 0x0B06,
+  0x0B2C, 0x0B51, 0x0B77, 0x0B9D, 0x0BC2, 0x0BE7, 0x0C0D, 0x0C32,
+  0x0C57, 0x0C7C, 0x0CA1, 0x0CC6, 0x0CEB, 0x0D10, 0x0D34, 0x0D59,
+  0x0D7D, 0x0DA2, 0x0DC6, 0x0DEA, 0x0E0F, 0x0E33, 0x0E56, 0x0E7A,
+  0x0E9E, 0x0EC2, 0x0EE5, 0x0F09, 0x0F2C, 0x0F50, 0x0F73, 0x0F96,
+  0x0FB9, 0x0FDC, 0x0FFF, 0x1021, 0x1044, 0x1067, 0x1089, 0x10AB,
+  0x10CE, 0x10F0, 0x1112, 0x1134, 0x1156, 0x1177, 0x1199, 0x11BB,
+  0x11DC, 0x11FD, 0x121F, 0x1240, 0x1261, 0x1282, 0x12A3, 0x12C3,
+  0x12E4, 0x1305, 0x1325, 0x1345, 0x1366, 0x1386, 0x13A6, 0x13C6,
+  0x13E6, 0x1405, 0x1425, 0x1444, 0x1464, 0x1483, 0x14A2, 0x14C1,
+  0x14E0, 0x14FF, 0x151E, 0x153D, 0x155B, 0x157A, 0x1598, 0x15B7,
+  0x15D5, 0x15F3, 0x1611, 0x162F, 0x164C, 0x166A, 0x1688, 0x16A5,
+  0x16C2, 0x16E0, 0x16FD, 0x171A, 0x1737, 0x1754, 0x1770, 0x178D,
+  0x17AA, 0x17C6, 0x17E2, 0x17FE, 0x181B, 0x1837, 0x1853, 0x186E,
+  0x188A, 0x18A6, 0x18C1, 0x18DD, 0x18F8, 0x1913, 0x192E, 0x1949,
+  0x1964, 0x197F, 0x199A, 0x19B4, 0x19CF, 0x19E9, 0x1A04, 0x1A1E,
+  0x1A38, 0x1A52, 0x1A6C, 0x1A86, 0x1A9F, 0x1AB9, 0x1AD3, 0x1AEC,
+  0x1B05, 0x1B1F, 0x1B38, 0x1B51, 0x1B6A, 0x1B83, 0x1B9C, 0x1BB4,
+  0x1BCD, 0x1BE5, 0x1BFE, 0x1C16, 0x1C2E, 0x1C46, 0x1C5E, 0x1C76,
+  0x1C8E, 0x1CA6, 0x1CBE, 0x1CD5, 0x1CED, 0x1D04, 0x1D1B, 0x1D33,
+  0x1D4A, 0x1D61, 0x1D78, 0x1D8E, 0x1DA5, 0x1DBC, 0x1DD3, 0x1DE9,
+  0x1DFF, 0x1E16, 0x1E2C, 0x1E42, 0x1E58, 0x1E6E, 0x1E84, 0x1E9A,
+  0x1EB0, 0x1EC5, 0x1EDB, 0x1EF0, 0x1F06, 0x1F1B, 0x1F30, 0x1F45,
+  0x1F5A, 0x1F6F, 0x1F84, 0x1F99, 0x1FAE, 0x1FC3, 0x1FD7, 0x1FEC,
+  0x2000,
+};
+
+// The sine of pos/0x4000 of a quarter turn, for pos from 0 to 0x4000
+static int32_t quarterSine(uint16_t pos)
+{
+  uint16_t i = pos >> 6;
+  uint16_t frac = pos & 0x3F;
+  int32_t a = i < 256 ? sineTable[i] : 0x10000;
+
+  if (frac == 0)
+    return a;
+
+  int32_t b = i < 255 ? sineTable[i + 1] : 0x10000;
+  return a + (((b - a) * frac) >> 6);
+}
+
+Fixed fixedSin(Angle angle)
+{
+  uint16_t pos = angle & 0x3FFF;
+
+  if (angle & ANGLE_90)
+    pos = ANGLE_90 - pos;
+
+  int32_t sine = quarterSine(pos);
+  return Fixed::fromRaw(angle & ANGLE_180 ? -sine : sine);
+}
+
+Fixed fixedCos(Angle angle)
+{
+  return fixedSin(angle + ANGLE_90);
+}
+
+Angle fixedAtan2(int32_t y, int32_t x)
+{
+  uint32_t ax = x < 0 ? -(uint32_t)x : x;
+  uint32_t ay = y < 0 ? -(uint32_t)y : y;
+  bool steep = ay > ax;
+  uint32_t hi = steep ? ay : ax;
+  uint32_t lo = steep ? ax : ay;
+
+  if (hi == 0)
+    return 0;
+
+  // Scale down so that lo << 16 can't overflow
+  uint8_t shift = hi >> 16 ? 16 - __builtin_clz(hi) : 0;
+  hi >>= shift;
+  lo >>= shift;
+
+  uint32_t ratio = (lo << 16) / hi;  // 0 to 0x10000
+  uint16_t i = ratio >> 8;
+  uint16_t frac = ratio & 0xFF;
+  uint16_t angle = atanTable[i];
+
+  if (frac != 0)
+    angle += ((atanTable[i + 1] - angle) * frac) >> 8;
+
+  if (steep)
+    angle = ANGLE_90 - angle;
+  if (x < 0)
+    angle = ANGLE_180 - angle;
+  if (y < 0)
+    angle = -angle;
+  return angle;
+}
+
+// The bit by bit method, one result bit per step
+uint16_t isqrt(uint32_t value)
+{
+  uint32_t root = 0;
+  uint32_t bit = 1UL << 30;
+
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+  return root;
+}
+
+static uint32_t isqrt64(uint64_t value)
+{
+  uint64_t root = 0;
+  uint64_t bit = 1ULL << 62;
+
+  while (bit > value)
+    bit >>= 2;
+
+  while (bit != 0)
+  {
+    if (value >= root + bit)
+    {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    }
+    else
+      root >>= 1;
+    bit >>= 2;
+  }
+  return root;
+}
+
+Fixed fixedSqrt(Fixed value)
+{
+  if (value.raw <= 0)
+    return 0;
+
+  // sqrt(raw / 2^16) * 2^16 = sqrt(raw * 2^16)
+  return Fixed::fromRaw(isqrt64((uint64_t)value.raw << 16));
+}
+
+Fixed fixedDistance(Fixed dx, Fixed dy)
+{
+  // The squares are 32.32, so their root is already 16.16
+  return Fixed::fromRaw(isqrt64((uint64_t)((int64_t)dx.raw*dx.raw) + (uint64_t)((int64_t)dy.raw*dy.raw)));
+}
+
+// max*123/128 + min*51/128, which is 3.9% short to 4.03% long depending on
+// the direction
+uint32_t approxDistance(int32_t dx, int32_t dy)
+{
+  uint32_t ax = dx < 0 ? -(uint32_t)dx : dx;
+  uint32_t ay = dy < 0 ? -(uint32_t)dy : dy;
+  uint32_t hi = ax > ay ? ax : ay;
+  uint32_t lo = ax > ay ? ay : ax;
+
+  return hi - (hi >> 5) - (hi >> 7) +
+         (lo >> 2) + (lo >> 3) + (lo >> 6) + (lo >> 7);
+}
+
+//===========================================
+//========== FixedVector functions ==========
+//===========================================
+
+FixedVector FixedVector::fromAngle(Angle angle, Fixed length)
+{
+  return FixedVector(fixedCos(angle) * length, fixedSin(angle) * length);
+}
+
+Angle FixedVector::angle() const
+{
+  return fixedAtan2(y.raw, x.raw);
+}
+
+Fixed FixedVector::length() const
+{
+  return fixedDistance(x, y);
+}
+
+Fixed FixedVector::approxLength() const
+{
+  return approxDistance(x, y);
+}
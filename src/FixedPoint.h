@@ -0,0 +1,414 @@
+/**
+ * @file FixedPoint.h
+ * \brief
+ * Fixed point numbers, vectors, and trigonometry without floating point.
+ *
+ * \details
+ * The processor has no hardware for `double` and floating point functions like
+ * `sinf()` are slow. The definitions here do the same work with integers.
+ *
+ * A `Fixed` holds its value in 16.16 fixed point, the format already used by
+ * `AffineMatrix` and `sweepRect()`, so its `raw` member can be passed to
+ * them directly. A `FixedVector` converts to a `Point` for drawing and
+ * collision functions.
+ */
+
+#ifndef FIXEDPOINT_H
+#define FIXEDPOINT_H
+
+#include <Arduino.h>
+
+// Angles, as used by fixedSin(), fixedCos() and fixedAtan2()
+
+#define ANGLE_0   0x0000
+#define ANGLE_45  0x2000
+#define ANGLE_90  0x4000
+#define ANGLE_180 0x8000
+#define ANGLE_270 0xC000
+
+/** \brief
+ * An angle, where a full turn is 0x10000.
+ *
+ * \details
+ * Angles increase clockwise on the screen, starting from the positive X axis,
+ * the same as `AffineMatrix::rotation()`. Since a full turn is the range of
+ * the type, angles wrap around by themselves.
+ */
+typedef uint16_t Angle;
+
+//========================================
+//========== FixedNumber object ==========
+//========================================
+
+/** \brief
+ * A fixed point number with `Fraction` fraction bits.
+ *
+ * \tparam T The integer type holding the value.
+ * \tparam Wide A type at least twice as wide as `T`, for multiplication and
+ * division.
+ * \tparam Fraction The number of fraction bits.
+ *
+ * \details
+ * Use the `Fixed` (16.16) and `Fixed8` (8.8) types rather than this template.
+ *
+ * Numbers can be created from integers and floating point values. Floating
+ * point constants are converted by the compiler:
+ *
+ * \code{.cpp}
+ * Fixed speed = 1.5;
+ * Fixed x = 10;
+ * x += speed * 2;
+ * x = 2 * x + speed;
+ * dmg.drawPixel(x.toInt(), 20);
+ * \endcode
+ *
+ * Results that don't fit in `T` wrap around.
+ */
+template<typename T, typename Wide, uint8_t Fraction>
+struct FixedNumber
+{
+  static const T ONE = (T)1 << Fraction; /**< The raw value of 1.0 */
+
+  T raw; /**< The value, scaled by `ONE` */
+
+  /** \brief
+   * The default constructor
+   */
+  FixedNumber() = default;
+
+  /** \brief
+   * Convert an integer.
+   */
+  constexpr FixedNumber(int value)
+    : raw((T)(value * ONE))
+  {}
+
+  /** \brief
+   * Convert an integer.
+   */
+  constexpr FixedNumber(long value)
+    : raw((T)(value * ONE))
+  {}
+
+  /** \brief
+   * Convert an integer, e.g. from `millis()` or `sizeof`.
+   */
+  constexpr FixedNumber(unsigned int value)
+    : raw((T)(value * ONE))
+  {}
+
+  /** \brief
+   * Convert an integer, e.g. from `millis()` or `sizeof`.
+   */
+  constexpr FixedNumber(unsigned long value)
+    : raw((T)(value * ONE))
+  {}
+
+  /** \brief
+   * Convert a floating point value, rounding to the nearest fixed point value.
+   */
+  constexpr FixedNumber(float value)
+    : raw((T)(value * ONE + (value < 0 ? -0.5f : 0.5f)))
+  {}
+
+  /** \brief
+   * Convert a floating point value, rounding to the nearest fixed point value.
+   */
+  constexpr FixedNumber(double value)
+    : raw((T)(value * ONE + (value < 0 ? -0.5 : 0.5)))
+  {}
+
+  /** \brief
+   * Create a number from its raw value.
+   *
+   * \param raw The value scaled by `ONE`.
+   */
+  static constexpr FixedNumber fromRaw(T raw)
+  {
+    return FixedNumber(raw, 0);
+  }
+
+  /** \brief
+   * Get the integer part, rounding down.
+   */
+  constexpr T toInt() const
+  {
+    return raw >> Fraction;
+  }
+
+  /** \brief
+   * Get the nearest integer, rounding halves up.
+   */
+  constexpr T round() const
+  {
+    return (T)(raw + ONE/2) >> Fraction;
+  }
+
+  /** \brief
+   * Get the fraction part, scaled by `ONE`.
+   *
+   * \details
+   * The fraction is never negative: -1.25 has an integer part of -2 and a
+   * fraction of 0.75.
+   */
+  constexpr T fraction() const
+  {
+    return raw & (ONE - 1);
+  }
+
+  /** \brief
+   * Convert to floating point.
+   */
+  constexpr float toFloat() const
+  {
+    return (float)raw / ONE;
+  }
+
+  constexpr FixedNumber operator-() const { return fromRaw(-raw); }
+
+  friend constexpr FixedNumber operator+(FixedNumber a, FixedNumber b) { return fromRaw(a.raw + b.raw); }
+  friend constexpr FixedNumber operator-(FixedNumber a, FixedNumber b) { return fromRaw(a.raw - b.raw); }
+
+  /** \brief
+   * Multiply, rounding down.
+   */
+  friend constexpr FixedNumber operator*(FixedNumber a, FixedNumber b)
+  {
+    return fromRaw((T)(((Wide)a.raw * b.raw) >> Fraction));
+  }
+
+  /** \brief
+   * Divide, rounding towards zero.
+   *
+   * \details
+   * Dividing by zero has the same effect as integer division by zero.
+   */
+  friend constexpr FixedNumber operator/(FixedNumber a, FixedNumber b)
+  {
+    return fromRaw((T)((Wide)a.raw * ONE / b.raw));
+  }
+
+  FixedNumber &operator+=(FixedNumber other) { return *this = *this + other; }
+  FixedNumber &operator-=(FixedNumber other) { return *this = *this - other; }
+  FixedNumber &operator*=(FixedNumber other) { return *this = *this * other; }
+  FixedNumber &operator/=(FixedNumber other) { return *this = *this / other; }
+
+  friend constexpr bool operator==(FixedNumber a, FixedNumber b) { return a.raw == b.raw; }
+  friend constexpr bool operator!=(FixedNumber a, FixedNumber b) { return a.raw != b.raw; }
+  friend constexpr bool operator<(FixedNumber a, FixedNumber b) { return a.raw < b.raw; }
+  friend constexpr bool operator<=(FixedNumber a, FixedNumber b) { return a.raw <= b.raw; }
+  friend constexpr bool operator>(FixedNumber a, FixedNumber b) { return a.raw > b.raw; }
+  friend constexpr bool operator>=(FixedNumber a, FixedNumber b) { return a.raw >= b.raw; }
+
+ private:
+  constexpr FixedNumber(T raw, int)
+    : raw(raw)
+  {}
+};
+
+/** \brief
+ * A 16.16 fixed point number, from -32768 to just under 32768 in steps of
+ * 1/65536.
+ */
+typedef FixedNumber<int32_t, int64_t, 16> Fixed;
+
+/** \brief
+ * An 8.8 fixed point number, from -128 to just under 128 in steps of 1/256.
+ *
+ * \details
+ * Half the size of a `Fixed`, for large arrays of values that don't need the
+ * range or precision.
+ */
+typedef FixedNumber<int16_t, int32_t, 8> Fixed8;
+
+//========================================
+//========== FixedVector object ==========
+//========================================
+
+/** \brief
+ * A 2D vector with `Fixed` components, for positions and velocities.
+ *
+ * \details
+ * A `FixedVector` converts to a `Point` by rounding its components down, so
+ * it can be passed directly to functions taking a `Point`.
+ */
+struct FixedVector
+{
+  Fixed x; /**< The X component */
+  Fixed y; /**< The Y component */
+
+  /** \brief
+   * The default constructor
+   */
+  FixedVector() = default;
+
+  /** \brief
+   * The fully initializing constructor
+   *
+   * \param x The X component. Copied to variable `x`.
+   * \param y The Y component. Copied to variable `y`.
+   */
+  constexpr FixedVector(Fixed x, Fixed y)
+    : x(x), y(y)
+  {}
+
+  /** \brief
+   * Get a vector pointing in a direction.
+   *
+   * \param angle The direction.
+   * \param length The length of the vector.
+   */
+  static FixedVector fromAngle(Angle angle, Fixed length);
+
+  /** \brief
+   * Get the direction of the vector, as from `fixedAtan2()`.
+   */
+  Angle angle() const;
+
+  /** \brief
+   * Get the exact length of the vector, as from `fixedDistance()`.
+   */
+  Fixed length() const;
+
+  /** \brief
+   * Get an estimate of the length of the vector, as from `approxDistance()`.
+   */
+  Fixed approxLength() const;
+
+  constexpr FixedVector operator-() const { return FixedVector(-x, -y); }
+  constexpr FixedVector operator+(const FixedVector &other) const { return FixedVector(x + other.x, y + other.y); }
+  constexpr FixedVector operator-(const FixedVector &other) const { return FixedVector(x - other.x, y - other.y); }
+  constexpr FixedVector operator*(Fixed scale) const { return FixedVector(x * scale, y * scale); }
+  constexpr FixedVector operator/(Fixed scale) const { return FixedVector(x / scale, y / scale); }
+
+  FixedVector &operator+=(const FixedVector &other) { return *this = *this + other; }
+  FixedVector &operator-=(const FixedVector &other) { return *this = *this - other; }
+  FixedVector &operator*=(Fixed scale) { return *this = *this * scale; }
+  FixedVector &operator/=(Fixed scale) { return *this = *this / scale; }
+
+  constexpr bool operator==(const FixedVector &other) const { return x == other.x && y == other.y; }
+  constexpr bool operator!=(const FixedVector &other) const { return x != other.x || y != other.y; }
+};
+
+//====================================
+//========== Math functions ==========
+//====================================
+
+/** \brief
+ * Get the sine of an angle.
+ *
+ * \param angle The angle.
+ *
+ * \return The sine, from -1.0 to 1.0.
+ *
+ * \details
+ * The result is interpolated from a table of 256 values per quarter turn and
+ * is within 2/65536 of the exact sine.
+ */
+Fixed fixedSin(Angle angle);
+
+/** \brief
+ * Get the cosine of an angle.
+ *
+ * \param angle The angle.
+ *
+ * \return The cosine, from -1.0 to 1.0.
+ *
+ * \details
+ * The accuracy is the same as `fixedSin()`.
+ */
+Fixed fixedCos(Angle angle);
+
+/** \brief
+ * Get the direction from 0, 0 to a point.
+ *
+ * \param y The Y coordinate of the point.
+ * \param x The X coordinate of the point.
+ *
+ * \return The angle of the point, or 0 if both coordinates are 0.
+ *
+ * \details
+ * The coordinates can be in any units, as long as they are the same, so
+ * pixels or the `raw` values of `Fixed` numbers work equally well. The result
+ * is within 2/65536 of a turn of the exact angle.
+ */
+Angle fixedAtan2(int32_t y, int32_t x);
+
+/** \brief
+ * Get the direction from 0, 0 to a point.
+ *
+ * \param y The Y coordinate of the point.
+ * \param x The X coordinate of the point.
+ *
+ * \return The angle of the point, or 0 if both coordinates are 0.
+ */
+inline Angle fixedAtan2(Fixed y, Fixed x)
+{
+  return fixedAtan2(y.raw, x.raw);
+}
+
+/** \brief
+ * Get the integer square root of a number.
+ *
+ * \param value The number.
+ *
+ * \return The square root, rounded down.
+ */
+uint16_t isqrt(uint32_t value);
+
+/** \brief
+ * Get the square root of a fixed point number.
+ *
+ * \param value The number.
+ *
+ * \return The square root, rounded down to the nearest 1/65536, or 0 if
+ * `value` is negative.
+ */
+Fixed fixedSqrt(Fixed value);
+
+/** \brief
+ * Get the exact distance from 0, 0 to a point.
+ *
+ * \param dx The X coordinate of the point.
+ * \param dy The Y coordinate of the point.
+ *
+ * \return The distance, rounded down.
+ *
+ * \details
+ * The squares are summed without overflowing, but a distance of 32768 or
+ * more doesn't fit in the result.
+ */
+Fixed fixedDistance(Fixed dx, Fixed dy);
+
+/** \brief
+ * Estimate the distance from 0, 0 to a point.
+ *
+ * \param dx The X coordinate of the point.
+ * \param dy The Y coordinate of the point.
+ *
+ * \return The distance, from 4% short to 4.1% long of the exact distance.
+ *
+ * \details
+ * The estimate needs no multiplication or square root, only shifts and
+ * additions, so it suits comparisons between many objects. The coordinates
+ * can be in any units, as long as they are the same. The shifts also round
+ * by up to 4 units, which only matters for short distances in whole pixels.
+ * `extras/fixedtables.py` reports the exact bounds, and
+ * `extras/test/fixedpoint_bench.cpp` checks them.
+ */
+uint32_t approxDistance(int32_t dx, int32_t dy);
+
+/** \brief
+ * Estimate the distance from 0, 0 to a point.
+ *
+ * \param dx The X coordinate of the point.
+ * \param dy The Y coordinate of the point.
+ *
+ * \return The distance, from 4% short to 4.1% long of the exact distance.
+ */
+inline Fixed approxDistance(Fixed dx, Fixed dy)
+{
+  return Fixed::fromRaw(approxDistance(dx.raw, dy.raw));
+}
+
+#endif